@@ -31,6 +31,12 @@ plt.plot(x_axis, mean[3], label="Struct of arrays")
 #plt.plot(x_axis, mean[4], label="Struct of arrays")
 #  Realigned array multiple access iteration
 #plt.plot(x_axis, mean[5], label="Struct of arrays")
+#  Tiled array construction, when measured
+#plt.plot(x_axis, mean[6], label="Tiled arrays of structs")
+#  Tiled array single access iteration
+#plt.plot(x_axis, mean[7], label="Tiled arrays of structs")
+#  Tiled array multiple access iteration
+#plt.plot(x_axis, mean[8], label="Tiled arrays of structs")
 plt.axvline(x=256000, linestyle='--', label='L1 Cache size', color='g')
 plt.axvline(x=1024000, linestyle='--', label='L2 Cache size', color='m')
 plt.xlabel('Bytes of data iterated upon')
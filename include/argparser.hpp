@@ -12,6 +12,7 @@ public:
 
 	void addBool(bool* var, std::string_view flag);
 	void addString(std::string* var, std::string_view flag);
+	void addUnsigned(unsigned* var, std::string_view flag);
 
 	void unwind();
 
@@ -19,7 +20,8 @@ private:
 	struct VarPtr {
 		enum struct Type {
 			Bool,
-			String
+			String,
+			Unsigned
 		};
 		void* ptr;
 		Type type;
@@ -48,6 +48,8 @@ struct ToplevelAstNode : public AstNode {
 	std::vector<ExternAstNode*> externs;
 	std::vector<StructAstNode*> structs;
 	std::vector<ToplevelAstNode*> toplevels;
+	std::string file;
+	Tokens tokens;	//Owned here so that node tokens outlive the parser
 
 	bool analyzed = false;
 };
@@ -68,6 +70,12 @@ struct FunctionAstNode : public AstNode {
 	FunctionAstNode(const std::string &identifier);
 	void accept(AstVisitor &visitor) override;
 	FunctionSignature signature;
+	std::unordered_set<std::string> stackArrays;	//Locals proven not to escape, see EscapeAnalysis
+	std::vector<bool> keptParams;	//Parameters the function may keep, grow or free, see EscapeAnalysis
+	std::vector<std::string> attributes;	//LLVM function attributes, see EffectAnalysis
+	std::vector<Token*> hints;	//Code generation hints, e.g. @fastmath
+	bool isInline = false;	//Always inlined into its callers
+	bool isFastMath() const;
 };
 
 struct ExternAstNode : public AstNode {
@@ -75,6 +83,7 @@ struct ExternAstNode : public AstNode {
 	void accept(AstVisitor &visitor) override;
 	FunctionSignature signature;
 	std::string name;
+	std::vector<Token*> attributes;	//Known effects of the external function, e.g. nounwind
 	bool visited = false;
 };
 
@@ -82,6 +91,10 @@ struct VariableDeclareAstNode : public AstNode {
 	void accept(AstVisitor &visitor) override;
 	Type type;
 	std::string identifier;
+	bool owned = false;	//Freed when leaving its scope, see OwnershipAnalysis
+	Heat heat = Heat::Normal;	//Struct members only, hot ones are laid out first and cold ones last
+	AstNode::Expr allocator;	//Storage of the array comes from it, e.g. @allocator(arena)
+	bool region = false;	//Declared in an arena block, its storage goes away with the block
 };
 
 struct ReturnAstNode : public AstNode {
@@ -93,15 +106,28 @@ struct BranchAstNode : public AstNode {
 	AstNode::Expr expr;
 };
 
+//Arrays declared inside are bump allocated and all released at once when leaving it
+struct ArenaAstNode : public AstNode {
+	void accept(AstVisitor &visitor) override;
+};
+
+//Optimizer hint on a loop, e.g. @unroll(4)
+struct LoopHint {
+	Token *token = nullptr;
+	int count = 0;	//Zero when not given
+};
+
 struct LoopAstNode : public AstNode {
 	void accept(AstVisitor &visitor) override;
 	AstNode::Expr expr;
 	AstNode::Child loopPrefix;
 	AstNode::Child loopSuffix;
+	std::vector<LoopHint> hints;
 };
 
 struct ExpressionAstNode : public AstNode {
 	int precedence = 0;
+	bool isUnsigned = false;	//Evaluates to an unsigned integer, set by the symbol pass
 };
 
 struct CallAstNode : public ExpressionAstNode {
@@ -134,11 +160,15 @@ struct ArrayAstNode : public ExpressionAstNode {
 	AstNode::Expr length;
 	Type type;
 	bool raArray = false;
+	unsigned stackLength = 0;	//Non-zero when the array is placed on the stack
 };
 
 struct IndexAstNode : public ExpressionAstNode { 
 	void accept(AstVisitor &visitor) override;
 	AstNode::Expr index;
+	AstNode::Expr end;	//Slices a[index:end], to the end of the array when left out
+	bool isSlice = false;
+	bool provenInBounds = false;	//Set by the symbol pass when no bounds check is needed
 };
 
 struct MemberVariableAstNode : public ExpressionAstNode {
@@ -151,6 +181,7 @@ struct VariableAstNode : public ExpressionAstNode {
 	VariableAstNode(const std::string &name);
 	void accept(AstVisitor &visitor) override;
 	std::string name;
+	bool moved = false;	//Owned array handed over, emptied once read
 };
 
 struct StringAstNode : public ExpressionAstNode {
@@ -163,7 +194,14 @@ struct IntAstNode : public ExpressionAstNode {
 	IntAstNode(int value);
 	IntAstNode(const std::string &value);
 	void accept(AstVisitor &visitor) override;
-	int value;
+	long long value;	//Literals beyond the range of int are of type i64
+};
+
+struct FloatAstNode : public ExpressionAstNode {
+	FloatAstNode(const std::string &value);
+	void accept(AstVisitor &visitor) override;
+	double value;
+	bool isDouble = false;	//Literal carried the 'd' suffix
 };
 
 struct BoolAstNode : public ExpressionAstNode {
@@ -183,6 +221,7 @@ public:
 	virtual void visit(VariableDeclareAstNode &node)	= 0;
 	virtual void visit(ReturnAstNode &node)				= 0;
 	virtual void visit(BranchAstNode &node)				= 0;
+	virtual void visit(ArenaAstNode &node)				= 0;
 	virtual void visit(LoopAstNode &node)				= 0;
 	virtual void visit(CallAstNode &node)				= 0;
 	virtual void visit(BinExpressionAstNode &node)		= 0;
@@ -194,6 +233,7 @@ public:
 	virtual void visit(VariableAstNode &node)			= 0;
 	virtual void visit(StringAstNode &node)				= 0;
 	virtual void visit(IntAstNode &node)				= 0;
+	virtual void visit(FloatAstNode &node)				= 0;
 	virtual void visit(BoolAstNode &node)				= 0;
 };
 
@@ -214,6 +254,7 @@ private:
 #endif
 
 	Token *getIf(TokenType type);
+	Token *peekIf(TokenType type);
 	void unget();
 	void discardWhile(TokenType type);
 	void discardUntil(TokenType type);
@@ -228,6 +269,7 @@ private:
 	AstNode::Child buildStatement();
 	AstNode::Child buildDecl();
 	AstNode::Child buildBranch();
+	AstNode::Child buildArena();
 	AstNode::Child buildLoop();
 	AstNode::Child buildWhile();
 	AstNode::Child buildFor();
@@ -11,6 +11,7 @@ public:
 	void visit(VariableDeclareAstNode &node) override;
 	void visit(ReturnAstNode &node) override;
 	void visit(BranchAstNode &node) override;
+	void visit(ArenaAstNode &node) override;
 	void visit(LoopAstNode &node) override;
 	void visit(CallAstNode &node) override;
 	void visit(BinExpressionAstNode &node) override;
@@ -22,6 +23,7 @@ public:
 	void visit(VariableAstNode &node) override;
 	void visit(StringAstNode &node) override;
 	void visit(IntAstNode &node) override;
+	void visit(FloatAstNode &node) override;
 	void visit(BoolAstNode &node) override;
 
 private:
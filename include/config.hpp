@@ -1,9 +1,23 @@
 #pragma once
 
+//How the capacity of a full array grows
+enum struct Growth {
+	Double,
+	Half,	//By half of the capacity, 1.5x
+	Page	//Doubles up to a page, then by half rounded up to whole pages
+};
+
 struct Config {
 	bool verbose = false;
 	bool verboseLexer = false;
 	bool verboseAst = false;
 	bool verboseSymtable = false;
 	bool verboseIR = false;
+	bool verboseEscape = false;
+	bool layoutReport = false;
+	bool boundsChecks = false;
+	bool fastMath = false;
+	unsigned optLevel = 0;
+	unsigned arrayAlignment = 64;	//Of array storage in bytes, a power of two
+	Growth growth = Growth::Double;
 };
@@ -0,0 +1,97 @@
+#pragma once
+#include "ast.hpp"
+#include "symtable.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+
+//Summarizes what every function may do to memory across the call graph, the result is
+//stored as LLVM function attributes so the optimizer may CSE and hoist calls
+class EffectAnalysis : public AstVisitor {
+public:
+	EffectAnalysis(SymTable *symtable);
+
+	void visit(ToplevelAstNode &node) override;
+	void visit(LinkAstNode &node) override;
+	void visit(StructAstNode &node) override;
+	void visit(FunctionAstNode &node) override;
+	void visit(ExternAstNode &node) override;
+	void visit(VariableDeclareAstNode &node) override;
+	void visit(ReturnAstNode &node) override;
+	void visit(BranchAstNode &node) override;
+	void visit(ArenaAstNode &node) override;
+	void visit(LoopAstNode &node) override;
+	void visit(CallAstNode &node) override;
+	void visit(BinExpressionAstNode &node) override;
+	void visit(UnaryExpressionAstNode &node) override;
+	void visit(CastExpressionAstNode &node) override;
+	void visit(ArrayAstNode &node) override;
+	void visit(IndexAstNode &node) override;
+	void visit(MemberVariableAstNode &node) override;
+	void visit(VariableAstNode &node) override;
+	void visit(StringAstNode &node) override;
+	void visit(IntAstNode &node) override;
+	void visit(FloatAstNode &node) override;
+	void visit(BoolAstNode &node) override;
+
+private:
+	template <typename T>
+	using Map = std::unordered_map<std::string, T>;
+
+	//Where memory touched by an access lives, as seen from the accessing function
+	enum struct Memory {
+		Local,	//Allocas of the function itself
+		Argument,	//Reached directly through a pointer parameter
+		Other
+	};
+
+	struct Effects {
+		bool operator==(const Effects &rhs) const;
+
+		bool reads = false;
+		bool writes = false;
+		bool otherMemory = false;	//Touches memory not reached through pointer parameters
+		bool frees = false;
+		bool unwinds = false;
+		bool mayNotReturn = false;
+		bool fresh = false;	//Returned pointer aliases nothing else
+	};
+
+	struct Call {
+		std::string callee;
+		std::vector<Memory> args;	//What the pointer arguments point to
+	};
+
+	struct Summary {
+		FunctionAstNode *function = nullptr;
+		Effects direct;
+		std::vector<Call> calls;
+		std::vector<std::string> returnedCalls;
+		bool returnsOther = false;	//Some return is not the result of a call
+	};
+
+	struct Frame {
+		Map<const Type*> types;
+		std::unordered_set<std::string> params;
+		Summary summary;
+	};
+
+	void collectFunctions(ToplevelAstNode &node);
+	void finish();
+	bool isRecursive(const std::string &name) const;
+	Effects calleeEffects(const std::string &callee) const;
+	Effects externEffects(const ExternAstNode &ext) const;
+	std::vector<std::string> attributesOf(const Effects &effects, const Type &returnType) const;
+	void access(Memory memory, bool write);
+	void allocate();
+	Memory locate(VariableAstNode &node, const Type *&type) const;
+	Memory pointee(AstNode &arg) const;
+
+	SymTable *symtable = nullptr;
+	Map<FunctionAstNode*> functions;
+	Map<ExternAstNode*> externs;
+	Map<Summary> summaries;
+	Map<Effects> effects;
+	std::vector<Frame> frames;
+	bool writing = false;
+};
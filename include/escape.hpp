@@ -0,0 +1,84 @@
+#pragma once
+#include "ast.hpp"
+#include "symtable.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+
+//Finds arrays that never leave the function creating them, so that they may live on the stack
+class EscapeAnalysis : public AstVisitor {
+public:
+	EscapeAnalysis(SymTable *symtable);
+
+	void visit(ToplevelAstNode &node) override;
+	void visit(LinkAstNode &node) override;
+	void visit(StructAstNode &node) override;
+	void visit(FunctionAstNode &node) override;
+	void visit(ExternAstNode &node) override;
+	void visit(VariableDeclareAstNode &node) override;
+	void visit(ReturnAstNode &node) override;
+	void visit(BranchAstNode &node) override;
+	void visit(ArenaAstNode &node) override;
+	void visit(LoopAstNode &node) override;
+	void visit(CallAstNode &node) override;
+	void visit(BinExpressionAstNode &node) override;
+	void visit(UnaryExpressionAstNode &node) override;
+	void visit(CastExpressionAstNode &node) override;
+	void visit(ArrayAstNode &node) override;
+	void visit(IndexAstNode &node) override;
+	void visit(MemberVariableAstNode &node) override;
+	void visit(VariableAstNode &node) override;
+	void visit(StringAstNode &node) override;
+	void visit(IntAstNode &node) override;
+	void visit(FloatAstNode &node) override;
+	void visit(BoolAstNode &node) override;
+
+	constexpr static unsigned maxArrayBytes = 4096;
+	constexpr static unsigned maxFrameBytes = 16384;
+
+private:
+	template <typename T>
+	using Map = std::unordered_map<std::string, T>;
+
+	//How the variable currently being visited is used by its parent
+	enum struct Use {
+		Value,
+		Address,
+		Assign,
+		Push,
+		Free,
+		Inspect
+	};
+
+	struct Frame {
+		FunctionAstNode *function = nullptr;
+		Map<const Type*> types;
+		Map<size_t> params;
+		Map<ArrayAstNode*> candidates;
+		std::vector<std::string> order;
+		Map<AstNode*> constants;
+		std::unordered_set<std::string> escaped;
+		std::unordered_set<std::string> reassigned;
+		std::unordered_set<std::string> allocated;	//Declared with an allocator or in an arena block
+		Map<unsigned> regional;	//Arena block arrays and slices of them, by the depth of their block
+		unsigned arenaDepth = 0;
+	};
+
+	void collectFunctions(ToplevelAstNode &node);
+	void analyze(FunctionAstNode &node);
+	void finish(Frame &frame);
+	bool paramMayEscape(const std::string &callee, size_t index);
+	bool isSliceValue(AstNode &arg) const;
+	std::string borrowedArray(AstNode &arg) const;
+	bool evaluate(AstNode *expr, const Frame &frame, int &value) const;
+	unsigned sizeOf(const Type &type) const;
+	unsigned alignOf(const Type &type) const;
+
+	SymTable *symtable = nullptr;
+	Map<FunctionAstNode*> functions;
+	Map<std::vector<bool>> escapingParams;
+	std::vector<Frame> frames;
+	Use use = Use::Value;
+	bool lent = false;	//Variable is only viewed, e.g. by a builtin such as reserve or a callee not keeping it
+	bool grown = false;	//Variable is the array a builtin such as reserve reallocates
+};
@@ -12,6 +12,7 @@ private:
 	void index(const std::string &str);
 	int step();
 	int get() const;
+	bool isFloatPart(std::string::const_iterator start, std::string::const_iterator end) const;
 	void expand(std::string &str);
 
 	Tokens tokens;
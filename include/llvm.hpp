@@ -4,12 +4,14 @@
 #include "symtable.hpp"
 
 #include "llvm/IR/Module.h"
+#include "llvm/Target/TargetMachine.h"
 
 #include <vector>
 #include <set>
 #include <string>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 
 struct ModuleInfo {
 	std::string name;
@@ -35,11 +37,14 @@ public:
 	void visit(ToplevelAstNode &node) override;
 	void visit(LinkAstNode &node) override;
 	void visit(StructAstNode &node) override;
+	void reportLayout(const Type &struc);
+	uint64_t layoutQuery(CallAstNode &node);
 	void visit(FunctionAstNode &node) override;
 	void visit(ExternAstNode &node) override;
 	void visit(VariableDeclareAstNode &node) override;
 	void visit(ReturnAstNode &node) override;
 	void visit(BranchAstNode &node) override;
+	void visit(ArenaAstNode &node) override;
 	void visit(LoopAstNode &node) override;
 	void visit(CallAstNode &node) override;
 	void visit(BinExpressionAstNode &node) override;
@@ -51,8 +56,12 @@ public:
 	void visit(VariableAstNode &node) override;
 	void visit(StringAstNode &node) override;
 	void visit(IntAstNode &node) override;
+	void visit(FloatAstNode &node) override;
 	void visit(BoolAstNode &node) override;
 
+	unsigned getBoundsChecksInserted() const;
+	unsigned getBoundsChecksElided() const;
+
 private:
 	template<typename T>
 	using Map = std::unordered_map<std::string, T>;
@@ -60,17 +69,24 @@ private:
 
 	llvm::Type *translateType(const Type &type);
 	llvm::Type *translateType(const Type &type, std::string &name);
-	void prepareToplevelNode(ToplevelAstNode &node);
+	void prepareToplevelNode(ToplevelAstNode &node, bool imported = false);
 	std::vector<FunctionAstNode*> getFuncsFromToplevel(ToplevelAstNode &node);
-	void buildFunctionDefinitions(const std::vector<FunctionAstNode*> &funcs);
+	void buildFunctionDefinitions(const std::vector<FunctionAstNode*> &funcs, bool imported);
 	void buildStructDefinitions(const std::vector<StructAstNode*> &structs);
+	void addAttributes(llvm::Function *func, const std::vector<std::string> &attributes);
 	void clear();
 
 	//Array related
-	llvm::Value *allocateHeap(Type type, llvm::Value *length);
-	llvm::Value *allocateHeap(llvm::Type *type, llvm::Value *length);
-	llvm::Value *reallocateHeap(Type type, llvm::Value *addr, llvm::Value *length);
+	llvm::Value *allocateHeap(llvm::Type *type, llvm::Value *length, llvm::Value *allocator = nullptr);
+	llvm::AllocaInst *allocateLocal(llvm::Type *type, const std::string &name = "");
+	llvm::Value *allocateStack(llvm::Type *type, unsigned length);
+	std::vector<llvm::Value*> allocateColumns(llvm::Type *arrayType, llvm::Value *capacity,
+		llvm::Value *allocator = nullptr);
+	llvm::Value *getColumnSizes(llvm::Type *arrayType);
 	llvm::Type *getArrayType(llvm::Type *type, const Type &ghoulType);
+	llvm::Type *getSliceType(llvm::Type *type, const Type &ghoulType);
+	void sliceArray(IndexAstNode &node);
+	llvm::Value *convertView(llvm::Value *view, llvm::Type *type);
 	void createArray(ArrayAstNode &node);
 	void indexArray(IndexAstNode &node);
 	bool shouldAssignArray();
@@ -79,8 +95,31 @@ private:
 	void setArrayLength(llvm::Instruction *array, llvm::Value *length);
 	void popArray(llvm::Instruction *array);
 	void pushArray(llvm::Instruction *array, llvm::Value *value);
+	llvm::Instruction *getArrayField(llvm::Value *array, unsigned field);
+	llvm::Value *getArrayData(llvm::Instruction *array);
+	llvm::Value *getElementSize(llvm::Instruction *array);
+	llvm::Value *getArrayAlignment();
+	llvm::Value *getAllocator(llvm::Value *array);
+	void exitRegion(llvm::Value *mark);
+	void callRuntime(const std::string &name, llvm::Instruction *array, std::vector<llvm::Value*> args);
+	void reserveArray(llvm::Instruction *array, llvm::Value *required, bool grow);
+	void appendArray(llvm::Instruction *array, llvm::Instruction *source);
+	void resizeArray(llvm::Instruction *array, llvm::Value *length);
+	void shrinkArray(llvm::Instruction *array);
 	void freeArray(llvm::Instruction *array);
-	void memcpy(llvm::Instruction *src, llvm::Instruction *dest, llvm::Value *length);
+	void clearArray(llvm::Value *array);
+	VariableDeclareAstNode *getOwnedArray(const std::string &name);
+	void freeOwnedArray(VariableDeclareAstNode &decl);
+	void freeOwnedArrays(size_t fromScope);
+	void checkBounds(llvm::Value *index, llvm::Value *length, Token *token);
+	void checkSliceBounds(llvm::Value *lo, llvm::Value *hi, llvm::Value *length, Token *token);
+	void trapUnless(llvm::Value *condition, const std::string &message, std::vector<llvm::Value*> args, Token *token);
+	void copyElements(llvm::Value *dest, llvm::Value *src, llvm::Value *count, bool mayOverlap);
+	void cloneArray(llvm::Instruction *target, llvm::Instruction *source);
+	void transposeArray(llvm::Instruction *target, llvm::Instruction *source);
+	void transposeElements(llvm::Value *data, const std::vector<llvm::Value*> &columns,
+		llvm::Value *length, bool toColumns);
+	void copyArray(llvm::Instruction *array, llvm::Instruction *source);
 
 	//RAArray related
 	llvm::Type *getRAArrayType(llvm::Type *type, const Type &ghoulType);
@@ -90,9 +129,25 @@ private:
 	void assignRAArray();
 	llvm::Value *getRAArrayLength(llvm::Instruction *raArray);
 	void freeRAArray(llvm::Instruction *array);
+	bool isRAArray(llvm::Value *array);
 
 	//Struct related
-	void assignStruct(llvm::Instruction *lhs, llvm::Value *rhs, llvm::Type *type);
+	void assignStruct(llvm::Value *lhs, llvm::Value *rhs, llvm::Type *type);
+
+	//Vector related
+	void indexVector(IndexAstNode &node);
+	void callBuiltin(CallAstNode &node);
+	llvm::Value *convert(llvm::Value *value, llvm::Type *type, bool fromSigned = true, bool toSigned = true);
+	llvm::Value *toLength(llvm::Value *value, const AstNode &expr);
+
+	//Alias information
+	llvm::MDNode *getTBAATag(const std::string &name);
+	llvm::MDNode *getTBAATag(const Type &type);
+	void annotateAccess(llvm::Instruction *access, llvm::Value *ptr, const Type &type);
+	void annotateDataPointer(llvm::LoadInst *load);
+	void scopeColumn(llvm::Value *element, llvm::Value *raArray, unsigned column);
+
+	llvm::MDNode *getLoopHints(const LoopAstNode &node);
 
 	llvm::Instruction *loadUntilLastPtr(llvm::Instruction *inst);
 	
@@ -103,27 +158,47 @@ private:
 	std::vector<llvm::Value*> callParams;
 	std::vector<llvm::Value*> indicies;
 	std::vector<llvm::Instruction*> instructions;
+	std::vector<std::vector<VariableDeclareAstNode*>> ownedArrays;
 
 	Map<llvm::StructType*> structTypes;
+	Map<StructAstNode*> structNodes;
 	Map<llvm::Function*> functions;
 	Map<llvm::Value*> values;
 	Map<Locals> allLocals;
+	Map<llvm::MDNode*> tbaaTags;
+	Map<std::vector<llvm::MDNode*>> columnScopes;	//Alias scope of every column, by RA array type
+	std::unordered_map<llvm::Value*, std::pair<llvm::MDNode*, llvm::MDNode*>> columnAccesses;
+	std::unordered_map<llvm::Value*, llvm::AllocaInst*> allocators;	//Array header to where its allocator is kept
+	std::unordered_set<llvm::Value*> regionArrays;
+	std::vector<std::pair<llvm::Value*, llvm::Value*>> regions;	//Mark and allocator of each arena block entered
+	llvm::MDNode *tbaaChar = nullptr;
 	Locals *locals = nullptr;
 	llvm::Function *function = nullptr;
+	const std::unordered_set<std::string> *stackArrays = nullptr;
+	std::string currentFile;
 
 	llvm::Value *arrayLength = nullptr;
+	llvm::Value *currentAllocator = nullptr;	//Of the array declaration being initialized
 	llvm::Type *lastLLVMType = nullptr;
 	const Type *lastType = nullptr;
 	unsigned getAddrsVisited = 0;
+	unsigned boundsChecksInserted = 0;
+	unsigned boundsChecksElided = 0;
 	bool lastStatementVisitedWasReturn = false;
 	bool lhsIsRAArray = false;
 	bool visitedRAAIndex = false;
+	unsigned visitedTileSize = 0;
 };
 
 bool gen(ModuleInfo *mi, Context *ctx);
 
 void tokensToBuilder(ModuleInfo *mi, Context *ctx);
 
+void optimize(ModuleInfo *mi, llvm::TargetMachine *machine);
+
+//Target of the host, created once
+llvm::TargetMachine *hostMachine();
+
 void write(ModuleInfo *mi, Context *ctx);
 
 void link(ModuleInfo *mi, Context *ctx);
@@ -0,0 +1,71 @@
+#pragma once
+#include "ast.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+
+//Decides which array locals own their memory, these are freed when leaving their scope
+class OwnershipAnalysis : public AstVisitor {
+public:
+	void visit(ToplevelAstNode &node) override;
+	void visit(LinkAstNode &node) override;
+	void visit(StructAstNode &node) override;
+	void visit(FunctionAstNode &node) override;
+	void visit(ExternAstNode &node) override;
+	void visit(VariableDeclareAstNode &node) override;
+	void visit(ReturnAstNode &node) override;
+	void visit(BranchAstNode &node) override;
+	void visit(ArenaAstNode &node) override;
+	void visit(LoopAstNode &node) override;
+	void visit(CallAstNode &node) override;
+	void visit(BinExpressionAstNode &node) override;
+	void visit(UnaryExpressionAstNode &node) override;
+	void visit(CastExpressionAstNode &node) override;
+	void visit(ArrayAstNode &node) override;
+	void visit(IndexAstNode &node) override;
+	void visit(MemberVariableAstNode &node) override;
+	void visit(VariableAstNode &node) override;
+	void visit(StringAstNode &node) override;
+	void visit(IntAstNode &node) override;
+	void visit(FloatAstNode &node) override;
+	void visit(BoolAstNode &node) override;
+
+private:
+	template <typename T>
+	using Map = std::unordered_map<std::string, T>;
+	using Names = std::unordered_set<std::string>;
+
+	//Variable read as a whole into another one, counted in the order names are used
+	struct Move {
+		VariableAstNode *var;
+		size_t use;
+		size_t loop;	//Start of the innermost loop around it, 0 outside of loops
+		bool isReturn;
+	};
+
+	struct Frame {
+		FunctionAstNode *function = nullptr;
+		Map<VariableDeclareAstNode*> candidates;
+		Map<std::vector<AstNode*>> sources;	//Every value a candidate is initialized or assigned with
+		std::vector<Move> moves;
+		std::vector<AstNode*> returns;
+		Names exposed;
+		Map<size_t> declared;
+		Map<size_t> lastUses;
+		std::vector<size_t> loops;
+		size_t uses = 0;
+	};
+
+	void collectFunctions(ToplevelAstNode &node);
+	void analyze(FunctionAstNode &node);
+	void finish(Frame &frame);
+	void consume(AstNode::Child &value, bool isReturn = false);
+	void noteUse(const std::string &name);
+	bool isOwning(AstNode *value, const Names &owned);
+	bool mayKeep(const std::string &callee, size_t index) const;
+	bool returnsOwning(const std::string &callee);
+
+	Map<FunctionAstNode*> functions;
+	Map<bool> owningReturns;
+	std::vector<Frame> frames;
+};
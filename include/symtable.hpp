@@ -12,6 +12,8 @@ public:
 	void dump() const;
 
 	bool pushFunc(const std::string &identifier, FunctionSignature *func);
+	static bool isBuiltin(const std::string &identifier);
+	static bool isLayoutQuery(const std::string &identifier);
 
 	void setActiveFunction(const std::string &str);
 	const Type *getLocal(const std::string &str) const;
@@ -30,6 +32,7 @@ public:
 	void visit(VariableDeclareAstNode &node) override;
 	void visit(ReturnAstNode &node) override;
 	void visit(BranchAstNode &node) override;
+	void visit(ArenaAstNode &node) override;
 	void visit(LoopAstNode &node) override;
 	void visit(CallAstNode &node) override;
 	void visit(BinExpressionAstNode &node) override;
@@ -41,6 +44,7 @@ public:
 	void visit(VariableAstNode &node) override;
 	void visit(StringAstNode &node) override;
 	void visit(IntAstNode &node) override;
+	void visit(FloatAstNode &node) override;
 	void visit(BoolAstNode &node) override;
 
 private:
@@ -54,8 +58,33 @@ private:
 	using Locals = Map<Local>;
 	using Structs = Map<Type>;
 
+	//Canonical 'for int i = 0; i < a?; i = i + 1' loop, tracked for bounds check elision
+	struct BoundsLoop {
+		std::string induction;
+		std::string array;
+		std::vector<IndexAstNode*> candidates;
+		bool arrayIsPtr = false;
+		bool invalid = false;
+		bool foreignShrink = false;
+		bool opaqueCall = false;
+	};
+
 	bool demoteExprToBool(AstNode::Expr &expr);
 	bool resolveCast(CallAstNode &call);
+	void checkLoopHint(const LoopHint &hint);
+	void visitBuiltin(CallAstNode &node);
+	void visitLayoutQuery(CallAstNode &node);
+	static bool isTransposed(const Type &lhs, const Type &rhs);
+	void transposeSource(AstNode &assign);
+	void visitAllocator(VariableDeclareAstNode &node);
+
+	bool matchBoundsLoop(LoopAstNode &node, BoundsLoop &loop);
+	void resolveBoundsLoops();
+	void scanUnchecked(AstNode *node);
+	void addBoundsCandidate(VariableAstNode *var, IndexAstNode &node);
+	void noteAssign(const std::string &identifier);
+	void noteShrink(const std::string &identifier);
+	void noteOpaqueCall();
 
 	Structs structs;
 	Map<const FunctionSignature*> functions;
@@ -66,7 +95,12 @@ private:
 
 	std::vector<Type> callArgTypes;
 	std::vector<Member> visitedMembers;
+	std::vector<BoundsLoop> boundsLoops;
+	std::vector<BoundsLoop> finishedBoundsLoops;
+	std::unordered_set<std::string> addressTaken;
+	VariableAstNode *indexedVariable = nullptr;
 	unsigned blockDepth = 0;
+	unsigned arenaDepth = 0;	//Arena blocks around the statement being visited
 	bool foundEarlyReturn = false;
 	bool insideStructDecl = false;
 };
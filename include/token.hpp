@@ -17,6 +17,7 @@ enum struct TokenType {
 	Semicolon,			// ;
 	Tilde,				// ~
 	At,					// @
+	Colon,				// :
 
 	ParensOpen,         // (
 	ParensClose,        // )
@@ -74,6 +75,7 @@ enum struct TokenType {
 	Link,				// link
 	Import,				// import
 	Volatile,			// volatile
+	Inline,				// inline
 
 
 	//Keep this one last
@@ -101,6 +103,7 @@ struct Token {
 		";",
 		"~",
 		"@",
+		":",
 
 		"(",
 		")",
@@ -152,7 +155,8 @@ struct Token {
 		"return",
 		"link",
 		"import",
-		"volatile"
+		"volatile",
+		"inline"
 	};
 
 	constexpr static std::array<std::string_view, 5> altStrs = {
@@ -5,6 +5,13 @@
 
 struct Member;
 
+//Access frequency of a struct member, annotated with hot or cold in front of it
+enum struct Heat {
+	Hot,
+	Normal,
+	Cold
+};
+
 struct Type {
 	Type() = default;
 	Type(const Type &rhs);
@@ -17,8 +24,14 @@ struct Type {
 
 	std::string string() const;
 	std::string fullString() const;
-	int size() const;
+	size_t size() const;
+	size_t alignment() const;
 	bool isStruct() const;
+	bool isInteger() const;
+	bool isUnsigned() const;
+
+	static bool isLaneCount(long long lanes);
+	static bool isPrimitive(const std::string &name);
 
 	//TODO: Reorder struct members
 	std::string name;
@@ -26,9 +39,13 @@ struct Type {
 	std::unique_ptr<Type> arrayOf;
 	std::vector<Member> members;
 	bool realignedArray = false;
+	unsigned tileSize = 0;	//Realigned arrays stored in blocks of this many elements, []@8 T
+	bool isSlice = false;	//Borrowed view into an array, [:]T
+	unsigned lanes = 0;	//Vector types like int4 hold several elements of type name
 };
 
 struct Member {
 	std::string identifier;
 	Type type;
+	Heat heat = Heat::Normal;
 };
@@ -21,6 +21,7 @@ NumValidity isFloatLiteral(const std::string &str, float &val);
 
 //TODO: Reconsider 'val' parameter
 NumValidity isIntLiteral(const std::string &str, int &val);
+NumValidity isIntLiteral(const std::string &str, long long &val);
 
 std::string consumeFile(const char* path);
 
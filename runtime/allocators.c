@@ -0,0 +1,232 @@
+#include "ghoulrt.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void failed(uint64_t bytes) {
+	fprintf(stderr, "Out of memory, could not allocate %llu bytes\n", (unsigned long long)bytes);
+	abort();
+}
+
+static uint64_t roundUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+//Arena
+
+typedef struct Chunk Chunk;
+struct Chunk {
+	Chunk *next;
+	uint64_t size;
+	max_align_t data[];
+};
+
+//Chunks stay in a list once allocated, going back to an earlier point only moves current and top
+typedef struct Arena {
+	GhoulAllocator base;
+	Chunk *first;
+	Chunk *current;	//Null before the first chunk
+	char *top;
+	uint64_t chunkSize;
+} Arena;
+
+static void *arenaAllocate(GhoulAllocator *self, uint64_t bytes, uint64_t alignment) {
+	Arena *arena = (Arena*)self;
+	uintptr_t top = roundUp((uintptr_t)arena->top, alignment);
+	for(;;) {
+		Chunk *chunk = arena->current;
+		uintptr_t end = chunk ? (uintptr_t)chunk->data + chunk->size : 0;
+		if(chunk && top <= end && bytes <= end - top) {
+			break;
+		}
+
+		//The rest of the chunk is left unused, the next one is used if it is large enough
+		Chunk *next = chunk ? chunk->next : arena->first;
+		if(!next || next->size < bytes + alignment) {
+			uint64_t size = bytes + alignment > arena->chunkSize ? bytes + alignment : arena->chunkSize;
+			Chunk *fresh = malloc(sizeof(Chunk) + size);
+			if(!fresh) {
+				failed(bytes);
+			}
+			fresh->next = next;
+			fresh->size = size;
+			if(chunk) {
+				chunk->next = fresh;
+			} else {
+				arena->first = fresh;
+			}
+			next = fresh;
+		}
+		arena->current = next;
+		top = roundUp((uintptr_t)next->data, alignment);
+	}
+
+	arena->top = (char*)(top + bytes);
+	return (void*)top;
+}
+
+//Only the last allocation can be given back, an array growing at the end of the arena stays in place
+static void arenaRelease(GhoulAllocator *self, void *data, uint64_t bytes, uint64_t alignment) {
+	(void)alignment;
+	Arena *arena = (Arena*)self;
+	if((char*)data + bytes == arena->top) {
+		arena->top = data;
+	}
+}
+
+GhoulAllocator *ghoul_arena_new(uint64_t chunkSize) {
+	Arena *arena = malloc(sizeof(Arena) );
+	if(!arena) {
+		failed(sizeof(Arena) );
+	}
+	arena->base.allocate = arenaAllocate;
+	arena->base.release = arenaRelease;
+	arena->first = NULL;
+	arena->current = NULL;
+	arena->top = NULL;
+	arena->chunkSize = chunkSize > 0 ? chunkSize : 64 * 1024;
+	return &arena->base;
+}
+
+//Keeps every chunk, so an arena reset every frame stops allocating once it has grown enough
+void ghoul_arena_reset(GhoulAllocator *self) {
+	Arena *arena = (Arena*)self;
+	arena->current = NULL;
+	arena->top = NULL;
+}
+
+void ghoul_arena_delete(GhoulAllocator *self) {
+	Arena *arena = (Arena*)self;
+	Chunk *chunk = arena->first;
+	while(chunk) {
+		Chunk *next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+	free(arena);
+}
+
+//Region, an arena per thread for arena blocks
+
+static _Thread_local Arena region = {{arenaAllocate, arenaRelease}, NULL, NULL, NULL, 64 * 1024};
+
+GhoulAllocator *ghoul_region_enter(GhoulRegionMark *mark) {
+	mark->chunk = region.current;
+	mark->top = region.top;
+	return &region.base;
+}
+
+void ghoul_region_exit(const GhoulRegionMark *mark) {
+	region.current = mark->chunk;
+	region.top = mark->top;
+}
+
+//Pool
+
+enum {
+	smallestClass = 6,
+	largestClass = 16,
+	classCount = largestClass - smallestClass + 1
+};
+
+static const uint64_t poolChunkSize = (uint64_t)1 << largestClass;
+
+typedef struct Block Block;
+struct Block {
+	Block *next;
+};
+
+typedef struct Pool {
+	GhoulAllocator base;
+	Block *blocks[classCount];
+	void **chunks;
+	uint64_t chunkCount;
+	uint64_t chunkCapacity;
+} Pool;
+
+//Blocks are carved from chunks aligned to their own size, so each one is aligned to its class
+static int sizeClass(uint64_t bytes, uint64_t alignment) {
+	uint64_t size = bytes > alignment ? bytes : alignment;
+	if(size > poolChunkSize) {
+		return -1;
+	}
+
+	int shift = smallestClass;
+	while(((uint64_t)1 << shift) < size) {
+		shift++;
+	}
+	return shift - smallestClass;
+}
+
+static void refill(Pool *pool, int sizeClass) {
+	void *chunk = aligned_alloc(poolChunkSize, poolChunkSize);
+	if(!chunk) {
+		failed(poolChunkSize);
+	}
+
+	if(pool->chunkCount == pool->chunkCapacity) {
+		pool->chunkCapacity = pool->chunkCapacity > 0 ? pool->chunkCapacity * 2 : 16;
+		void **chunks = realloc(pool->chunks, pool->chunkCapacity * sizeof(void*) );
+		if(!chunks) {
+			failed(pool->chunkCapacity * sizeof(void*) );
+		}
+		pool->chunks = chunks;
+	}
+	pool->chunks[pool->chunkCount++] = chunk;
+
+	uint64_t size = (uint64_t)1 << (sizeClass + smallestClass);
+	for(uint64_t offset = poolChunkSize; offset >= size; offset -= size) {
+		Block *block = (Block*)((char*)chunk + offset - size);
+		block->next = pool->blocks[sizeClass];
+		pool->blocks[sizeClass] = block;
+	}
+}
+
+static void *poolAllocate(GhoulAllocator *self, uint64_t bytes, uint64_t alignment) {
+	Pool *pool = (Pool*)self;
+	int index = sizeClass(bytes, alignment);
+	if(index < 0) {
+		alignment = alignment > sizeof(void*) ? alignment : sizeof(void*);
+		return aligned_alloc(alignment, roundUp(bytes, alignment) );
+	}
+
+	if(!pool->blocks[index]) {
+		refill(pool, index);
+	}
+	Block *block = pool->blocks[index];
+	pool->blocks[index] = block->next;
+	return block;
+}
+
+static void poolRelease(GhoulAllocator *self, void *data, uint64_t bytes, uint64_t alignment) {
+	Pool *pool = (Pool*)self;
+	int index = sizeClass(bytes, alignment);
+	if(index < 0) {
+		free(data);
+		return;
+	}
+
+	Block *block = data;
+	block->next = pool->blocks[index];
+	pool->blocks[index] = block;
+}
+
+GhoulAllocator *ghoul_pool_new(void) {
+	Pool *pool = calloc(1, sizeof(Pool) );
+	if(!pool) {
+		failed(sizeof(Pool) );
+	}
+	pool->base.allocate = poolAllocate;
+	pool->base.release = poolRelease;
+	return &pool->base;
+}
+
+void ghoul_pool_delete(GhoulAllocator *self) {
+	Pool *pool = (Pool*)self;
+	for(uint64_t i = 0; i < pool->chunkCount; i++) {
+		free(pool->chunks[i]);
+	}
+	free(pool->chunks);
+	free(pool);
+}
@@ -0,0 +1,207 @@
+#include "ghoulrt.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Called off the hot path of generated code, never worth inlining
+#define GHOUL_COLD __attribute__((noinline, cold))
+
+static const uint64_t pageSize = 4096;
+static const uint64_t lineSize = 64;
+
+static GHOUL_COLD void outOfMemory(uint64_t count, uint64_t elementSize) {
+	fprintf(stderr, "Out of memory, could not allocate %llu elements of %llu bytes\n",
+		(unsigned long long)count, (unsigned long long)elementSize);
+	abort();
+}
+
+//Goes to the allocator when there is one, to the C heap otherwise
+static void *allocate(GhoulAllocator *allocator, uint64_t count, uint64_t elementSize, uint64_t alignment) {
+	if(elementSize > 0 && count > UINT64_MAX / elementSize) {
+		outOfMemory(count, elementSize);
+	}
+
+	uint64_t bytes = count * elementSize;
+	void *data = NULL;
+	if(bytes == 0) {
+		return NULL;
+	} else if(allocator) {
+		data = allocator->allocate(allocator, bytes, alignment);
+	} else if(posix_memalign(&data, alignment > sizeof(void*) ? alignment : sizeof(void*), bytes) != 0) {
+		data = NULL;
+	}
+
+	if(!data) {
+		outOfMemory(count, elementSize);
+	}
+	return data;
+}
+
+static void release(GhoulAllocator *allocator, void *data, uint64_t bytes, uint64_t alignment) {
+	if(!allocator) {
+		free(data);
+	} else if(data && bytes > 0) {
+		allocator->release(allocator, data, bytes, alignment);
+	}
+}
+
+static void reallocate(GhoulArray *array, uint64_t capacity, uint64_t elementSize, uint64_t alignment,
+		GhoulAllocator *allocator) {
+	if(elementSize > 0 && capacity > UINT64_MAX / elementSize) {
+		outOfMemory(capacity, elementSize);
+	}
+
+	//A null array gets its first allocation here
+	if(!allocator && alignment <= _Alignof(max_align_t) ) {
+		void *data = realloc(array->data, capacity * elementSize);
+		if(!data && capacity > 0 && elementSize > 0) {
+			outOfMemory(capacity, elementSize);
+		}
+		array->data = data;
+		array->capacity = capacity;
+		return;
+	}
+
+	//realloc would only keep malloc's alignment, the elements move by hand
+	void *data = allocate(allocator, capacity, elementSize, alignment);
+	uint64_t kept = array->capacity < capacity ? array->capacity : capacity;
+	if(kept * elementSize > 0) {
+		memcpy(data, array->data, kept * elementSize);
+	}
+	release(allocator, array->data, array->capacity * elementSize, alignment);
+	array->data = data;
+	array->capacity = capacity;
+}
+
+static uint64_t growCapacity(uint64_t capacity, uint64_t required, uint64_t elementSize, uint32_t growth) {
+	uint64_t doubled = capacity * 2;
+	uint64_t half = capacity + capacity / 2;
+	doubled = doubled > required ? doubled : required;
+	half = half > required ? half : required;
+
+	if(growth == GHOUL_GROWTH_DOUBLE) {
+		return doubled;
+	} else if(growth == GHOUL_GROWTH_HALF) {
+		return half;
+	}
+
+	//Small arrays double, larger ones grow by half and are rounded up to whole pages
+	elementSize = elementSize > 0 ? elementSize : 1;
+	if(doubled * elementSize < pageSize) {
+		return doubled;
+	}
+	uint64_t bytes = (half * elementSize + pageSize - 1) & ~(pageSize - 1);
+	return bytes / elementSize;
+}
+
+GHOUL_COLD void *ghoul_array_alloc(uint64_t count, uint64_t elementSize, uint64_t alignment,
+		GhoulAllocator *allocator) {
+	return allocate(allocator, count, elementSize, alignment);
+}
+
+GHOUL_COLD void ghoul_array_grow(GhoulArray *array, uint64_t required, uint64_t elementSize, uint32_t growth,
+		uint64_t alignment, GhoulAllocator *allocator) {
+	if(required > array->capacity) {
+		reallocate(array, growCapacity(array->capacity, required, elementSize, growth), elementSize, alignment,
+			allocator);
+	}
+}
+
+GHOUL_COLD void ghoul_array_reserve(GhoulArray *array, uint64_t required, uint64_t elementSize, uint64_t alignment,
+		GhoulAllocator *allocator) {
+	if(required > array->capacity) {
+		reallocate(array, required, elementSize, alignment, allocator);
+	}
+}
+
+GHOUL_COLD void ghoul_array_shrink(GhoulArray *array, uint64_t elementSize, uint64_t alignment,
+		GhoulAllocator *allocator) {
+	if(array->size < array->capacity) {
+		reallocate(array, array->size, elementSize, alignment, allocator);
+	}
+}
+
+GHOUL_COLD void ghoul_array_append(GhoulArray *array, const GhoulArray *source, uint64_t elementSize,
+		uint32_t growth, uint64_t alignment, GhoulAllocator *allocator) {
+	uint64_t count = source->size;
+	if(count == 0) {
+		return;
+	}
+
+	ghoul_array_grow(array, array->size + count, elementSize, growth, alignment, allocator);
+	memmove((char*)array->data + array->size * elementSize, source->data, count * elementSize);
+	array->size += count;
+}
+
+GHOUL_COLD void ghoul_array_free(GhoulArray *array, uint64_t elementSize, uint64_t alignment,
+		GhoulAllocator *allocator) {
+	release(allocator, array->data, array->capacity * elementSize, alignment);
+}
+
+//Bytes of the block holding capacity elements of every column, offsets receives where each one starts
+static uint64_t columnsSize(uint64_t capacity, uint32_t count, const uint64_t *sizes, uint64_t alignment,
+		uint64_t *offsets) {
+	uint64_t end = 0;
+	for(uint32_t i = 0; i < count; i++) {
+		if(sizes[i] > 0 && capacity > (UINT64_MAX - end - alignment) / sizes[i]) {
+			outOfMemory(capacity, sizes[i]);
+		}
+		offsets[i] = end;
+		end = (end + capacity * sizes[i] + alignment - 1) & ~(alignment - 1);
+	}
+	return end;
+}
+
+static void relocateColumns(GhoulColumns *array, uint64_t capacity, uint32_t count, const uint64_t *sizes,
+		uint64_t alignment, GhoulAllocator *allocator) {
+	alignment = alignment > lineSize ? alignment : lineSize;
+	uint64_t offsets[count > 0 ? count : 1];
+	uint64_t oldSize = columnsSize(array->capacity, count, sizes, alignment, offsets);
+	uint64_t end = columnsSize(capacity, count, sizes, alignment, offsets);
+	char *block = allocate(allocator, end / alignment, alignment, alignment);
+
+	//Every column moves, the old block starts at the first one
+	void *old = count > 0 && array->capacity > 0 ? array->columns[0] : NULL;
+	for(uint32_t i = 0; i < count; i++) {
+		if(array->size > 0) {
+			memcpy(block + offsets[i], array->columns[i], array->size * sizes[i]);
+		}
+		array->columns[i] = block + offsets[i];
+	}
+	release(allocator, old, oldSize, alignment);
+	array->capacity = capacity;
+}
+
+GHOUL_COLD void ghoul_columns_grow(GhoulColumns *array, uint64_t required, uint32_t count, const uint64_t *sizes,
+		uint32_t growth, uint64_t alignment, GhoulAllocator *allocator) {
+	if(required <= array->capacity) {
+		return;
+	}
+
+	uint64_t rowSize = 0;
+	for(uint32_t i = 0; i < count; i++) {
+		rowSize += sizes[i];
+	}
+	relocateColumns(array, growCapacity(array->capacity, required, rowSize, growth), count, sizes, alignment,
+		allocator);
+}
+
+GHOUL_COLD void ghoul_columns_reserve(GhoulColumns *array, uint64_t required, uint32_t count, const uint64_t *sizes,
+		uint64_t alignment, GhoulAllocator *allocator) {
+	if(required > array->capacity) {
+		relocateColumns(array, required, count, sizes, alignment, allocator);
+	}
+}
+
+GHOUL_COLD void ghoul_columns_free(GhoulColumns *array, uint32_t count, const uint64_t *sizes, uint64_t alignment,
+		GhoulAllocator *allocator) {
+	if(array->capacity == 0 || count == 0) {
+		return;
+	}
+
+	alignment = alignment > lineSize ? alignment : lineSize;
+	uint64_t offsets[count];
+	release(allocator, array->columns[0], columnsSize(array->capacity, count, sizes, alignment, offsets), alignment);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+
+//Layout of a ghoul array header, {T*, i64, i64} for every element type
+typedef struct GhoulArray {
+	void *data;
+	uint64_t size;
+	uint64_t capacity;
+} GhoulArray;
+
+//Layout of a realigned array header, {i64, i64, T1*, T2*, ...} with one column per struct member.
+//The columns share one block, in member order and each starting on a cache line
+typedef struct GhoulColumns {
+	uint64_t size;
+	uint64_t capacity;
+	void *columns[];
+} GhoulColumns;
+
+//Matches the order of Growth in include/config.hpp
+enum {
+	GHOUL_GROWTH_DOUBLE,
+	GHOUL_GROWTH_HALF,
+	GHOUL_GROWTH_PAGE
+};
+
+//Where array storage comes from, Allocator in lib/alloc.gh has the same layout.
+//Functions taking an allocator use the C heap when it is null
+typedef struct GhoulAllocator GhoulAllocator;
+struct GhoulAllocator {
+	void *(*allocate)(GhoulAllocator *self, uint64_t bytes, uint64_t alignment);
+	//Gets back the size and alignment the data was allocated with
+	void (*release)(GhoulAllocator *self, void *data, uint64_t bytes, uint64_t alignment);
+};
+
+//Functions taking an alignment, a power of two, keep the data at that alignment when it moves
+
+//Storage for count elements, null when there are none
+void *ghoul_array_alloc(uint64_t count, uint64_t elementSize, uint64_t alignment, GhoulAllocator *allocator);
+//Makes room for at least required elements, following a growth policy
+void ghoul_array_grow(GhoulArray *array, uint64_t required, uint64_t elementSize, uint32_t growth,
+	uint64_t alignment, GhoulAllocator *allocator);
+//Makes room for exactly required elements, if there is not room already
+void ghoul_array_reserve(GhoulArray *array, uint64_t required, uint64_t elementSize, uint64_t alignment,
+	GhoulAllocator *allocator);
+//Drops any capacity beyond the size
+void ghoul_array_shrink(GhoulArray *array, uint64_t elementSize, uint64_t alignment, GhoulAllocator *allocator);
+//Copies all elements of source to the end of array
+void ghoul_array_append(GhoulArray *array, const GhoulArray *source, uint64_t elementSize, uint32_t growth,
+	uint64_t alignment, GhoulAllocator *allocator);
+void ghoul_array_free(GhoulArray *array, uint64_t elementSize, uint64_t alignment, GhoulAllocator *allocator);
+
+//Same as above for realigned arrays, sizes holds the element size of each of the count columns.
+//Columns start on a cache line, or at the alignment if it is larger
+void ghoul_columns_grow(GhoulColumns *array, uint64_t required, uint32_t count, const uint64_t *sizes,
+	uint32_t growth, uint64_t alignment, GhoulAllocator *allocator);
+void ghoul_columns_reserve(GhoulColumns *array, uint64_t required, uint32_t count, const uint64_t *sizes,
+	uint64_t alignment, GhoulAllocator *allocator);
+void ghoul_columns_free(GhoulColumns *array, uint32_t count, const uint64_t *sizes, uint64_t alignment,
+	GhoulAllocator *allocator);
+
+//Allocators shipped with the runtime, see lib/alloc.gh
+
+//Bumps a pointer through chunks of at least chunkSize bytes, memory only comes back on reset or delete.
+//Chunks are kept on reset and reused
+GhoulAllocator *ghoul_arena_new(uint64_t chunkSize);
+void ghoul_arena_reset(GhoulAllocator *arena);
+void ghoul_arena_delete(GhoulAllocator *arena);
+
+//Where the region of the thread was when entering an arena block, leaving it goes back there
+typedef struct GhoulRegionMark {
+	void *chunk;
+	void *top;
+} GhoulRegionMark;
+
+GhoulAllocator *ghoul_region_enter(GhoulRegionMark *mark);
+void ghoul_region_exit(const GhoulRegionMark *mark);
+
+//Keeps freed blocks in power of two size classes for reuse, blocks above the largest class use the C heap
+GhoulAllocator *ghoul_pool_new(void);
+void ghoul_pool_delete(GhoulAllocator *pool);
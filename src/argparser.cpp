@@ -18,6 +18,11 @@ void ArgParser::addString(std::string* var, std::string_view flag) {
 	flags.insert({flag, {static_cast<void*>(var), VarPtr::Type::String} });
 }
 
+void ArgParser::addUnsigned(unsigned* var, std::string_view flag) {
+	verboseAssert(var, "Adressed passed was nullptr");
+	flags.insert({flag, {static_cast<void*>(var), VarPtr::Type::Unsigned} });
+}
+
 void ArgParser::unwind() {
 	for(auto it = args.begin(); it != args.end(); it++) {
 		auto hashIt = flags.find(*it);
@@ -43,6 +48,16 @@ void ArgParser::unwind() {
 			case VarPtr::Type::String:
 				static_cast<std::string*>(var.ptr)->assign(*std::next(it) );
 				break;
+			case VarPtr::Type::Unsigned: {
+				int value;
+				if(isIntLiteral(std::string(*std::next(it) ), value) != NumValidity::Ok || value < 0) {
+					std::cerr << "Expected a non-negative number for argument " << hashIt->first
+						<< ", recieved " << *std::next(it) << '\n';
+					std::exit(EXIT_FAILURE);
+				}
+				*static_cast<unsigned*>(var.ptr) = value;
+				break;
+			}
 		}
 
 		if(var.type != VarPtr::Type::Bool) std::advance(it, 1);
@@ -43,6 +43,12 @@ void FunctionAstNode::accept(AstVisitor &visitor) {
 	visitor.visit(*this);
 }
 
+bool FunctionAstNode::isFastMath() const {
+	return Global::config.fastMath || std::any_of(hints.begin(), hints.end(), [](Token *hint) {
+		return hint->value == "fastmath";
+	});
+}
+
 ExternAstNode::ExternAstNode(const std::string &identifier)
 	: name(identifier) {
 }
@@ -63,6 +69,10 @@ void BranchAstNode::accept(AstVisitor &visitor) {
 	visitor.visit(*this);
 }
 
+void ArenaAstNode::accept(AstVisitor &visitor) {
+	visitor.visit(*this);
+}
+
 void LoopAstNode::accept(AstVisitor &visitor) {
 	visitor.visit(*this);
 }
@@ -150,6 +160,16 @@ void IntAstNode::accept(AstVisitor &visitor) {
 	visitor.visit(*this);
 }
 
+FloatAstNode::FloatAstNode(const std::string &value) {
+	isDouble = endsWith(value, "d");
+	this->value = std::stod(isDouble ? value.substr(0, value.size() - 1) : value);
+	precedence = Token::precedence(TokenType::FloatLiteral);
+}
+
+void FloatAstNode::accept(AstVisitor &visitor) {
+	visitor.visit(*this);
+}
+
 BoolAstNode::BoolAstNode(bool value) 
 	: value(value) {
 }
@@ -162,7 +182,11 @@ AstNode::Root AstParser::buildTree(Tokens &&tokens, SymTable *symtable) {
 	this->tokens = tokens;
 	this->symtable = symtable;
 	iterator = this->tokens.begin();
-	return buildTree();
+	auto toplevel = buildTree();
+	if(toplevel) {
+		toplevel->tokens = std::move(this->tokens);
+	}
+	return toplevel;
 }
 
 
@@ -201,6 +225,11 @@ Token *AstParser::getIf(TokenType type) {
 	return &*(iterator++);
 }
 
+Token *AstParser::peekIf(TokenType type) {
+	if(iterator == tokens.end() || iterator->type != type) return nullptr;
+	return &*iterator;
+}
+
 void AstParser::unget() {
 	if(iterator != tokens.begin() ) {
 		--iterator;
@@ -236,7 +265,20 @@ AstNode::Root AstParser::buildTree() {
 			toplevel->addChild(std::move(import) );
 			continue;
 		}
-		else if(getIf(TokenType::Function) ) {
+		else if(getIf(TokenType::Inline) ) {
+			if(!getIf(TokenType::Function) ) {
+				unexpected();
+				return nullptr;
+			}
+			auto func = buildFunction();
+			if(!func) {
+				return nullptr;
+			}
+			auto fptr = static_cast<FunctionAstNode*>(func.get() );
+			fptr->isInline = true;
+			toplevel->addFunction(fptr);
+			toplevel->addChild(std::move(func) );
+		} else if(getIf(TokenType::Function) ) {
 			auto func = buildFunction();
 			if(!func) {
 				return nullptr;
@@ -338,11 +380,23 @@ AstNode::Child AstParser::buildStruct() {
 		if(!id) {
 			break;
 		}
-		unget();
+
+		//hot and cold are annotations when a type follows, e.g. cold char* name, else they name a type
+		Heat heat = Heat::Normal;
+		bool annotated = (id->value == "hot" || id->value == "cold") && (peekIf(TokenType::ArrayStart)
+			|| (peekIf(TokenType::Identifier) && std::next(iterator) != tokens.end()
+			&& (std::next(iterator)->type == TokenType::Identifier || std::next(iterator)->type == TokenType::Multiply) ) );
+		if(annotated) {
+			heat = id->value == "hot" ? Heat::Hot : Heat::Cold;
+		} else {
+			unget();
+		}
+
 		child = buildDecl();
 		if(!child) {
 			return unexpected();
 		}
+		static_cast<VariableDeclareAstNode&>(*child).heat = heat;
 		struc->addChild(std::move(child) );
 		discardWhile(TokenType::Terminator);
 	}
@@ -415,6 +469,15 @@ AstNode::Child AstParser::buildFunction() {
 	} 
 
 	function->signature.returnType = type;
+
+	//Optional hints before the body, e.g. fn dot(...) float @fastmath {
+	while(getIf(TokenType::At) ) {
+		Token *hint = getIf(TokenType::Identifier);
+		if(!hint) {
+			return unexpected();
+		}
+		function->hints.push_back(hint);
+	}
 	
 	if(!getIf(TokenType::BlockOpen) ) {
 		return unexpected();
@@ -436,6 +499,12 @@ AstNode::Child AstParser::buildFunction() {
 }
 
 AstNode::Child AstParser::buildExtern() {
+	//Optional attributes in front of fn, e.g. extern nounwind readonly fn
+	std::vector<Token*> attributes;
+	while(Token *attribute = getIf(TokenType::Identifier) ) {
+		attributes.push_back(attribute);
+	}
+
 	if(!getIf(TokenType::Function) ) {
 		return unexpected();
 	}
@@ -451,6 +520,7 @@ AstNode::Child AstParser::buildExtern() {
 
 	auto ext = std::make_unique<ExternAstNode>(id->value);
 	ext->token = id;
+	ext->attributes = std::move(attributes);
 	while(!getIf(TokenType::ParensClose) ) {
 		/*
 		id = getIf(TokenType::Identifier);
@@ -543,6 +613,10 @@ AstNode::Child AstParser::buildStatement() {
 	if(node) {
 		return node;
 	}
+	node = buildArena();
+	if(node) {
+		return node;
+	}
 	node = buildLoop();
 	if(node) {
 		return node;
@@ -608,6 +682,19 @@ AstNode::Child AstParser::buildDecl() {
 		Global::errStack.push("'var' declaration expects an assignment", &*iterator);
 	}
 
+	//Optional allocator after the declaration, e.g. []int values = [n]int @allocator(arena)
+	if(getIf(TokenType::At) ) {
+		Token *name = getIf(TokenType::Identifier);
+		if(!name || name->value != "allocator" || !getIf(TokenType::ParensOpen) ) {
+			return unexpected();
+		}
+
+		decl->allocator = buildExpr();
+		if(!decl->allocator || !getIf(TokenType::ParensClose) ) {
+			return unexpected();
+		}
+	}
+
 	decl->type = type;
 	return decl;
 }
@@ -660,6 +747,38 @@ AstNode::Child AstParser::buildBranch() {
 	return br;
 }
 
+AstNode::Child AstParser::buildArena() {
+	//Not a keyword, arena only starts a block when one follows
+	Token *tok = getIf(TokenType::Identifier);
+	if(!tok) {
+		return nullptr;
+	} else if(tok->value != "arena" || !peekIf(TokenType::BlockOpen) ) {
+		unget();
+		return nullptr;
+	}
+
+	auto arena = std::make_unique<ArenaAstNode>();
+	arena->token = tok;
+	getIf(TokenType::BlockOpen);
+	if(!getIf(TokenType::Terminator) ) {
+		return unexpected();
+	}
+
+	discardWhile(TokenType::Terminator);
+	auto stmnt = buildStatement();
+	while(stmnt) {
+		arena->addChild(std::move(stmnt) );
+		discardWhile(TokenType::Terminator);
+		stmnt = buildStatement();
+	}
+
+	if(!getIf(TokenType::BlockClose) ) {
+		return unexpected();
+	}
+
+	return arena;
+}
+
 AstNode::Child AstParser::buildLoop() {
 	auto loop = buildWhile();
 	if(!loop) {
@@ -670,6 +789,25 @@ AstNode::Child AstParser::buildLoop() {
 		return nullptr;
 	}
 
+	//Optional hints before the body, e.g. for ... @vectorize @unroll(4) {
+	auto &hints = static_cast<LoopAstNode&>(*loop).hints;
+	while(getIf(TokenType::At) ) {
+		LoopHint hint;
+		hint.token = getIf(TokenType::Identifier);
+		if(!hint.token) {
+			return unexpected();
+		}
+
+		if(getIf(TokenType::ParensOpen) ) {
+			Token *count = getIf(TokenType::IntLiteral);
+			if(!count || !getIf(TokenType::ParensClose) ) {
+				return unexpected();
+			}
+			isIntLiteral(count->value, hint.count);
+		}
+		hints.push_back(hint);
+	}
+
 	Token *tok = getIf(TokenType::BlockOpen);
 	if(!tok) {
 		return unexpected();
@@ -832,6 +970,14 @@ AstNode::Expr AstParser::buildPrimaryExpr() {
 		}
 	}
 
+	if(!tok) {
+		tok = getIf(TokenType::FloatLiteral);
+		if(tok) {
+			mayParseAssign = false;
+			expr = std::make_unique<FloatAstNode>(tok->value);
+		}
+	}
+
 	if(!tok) {
 		bool val = false;
 		tok = getIf(TokenType::False);
@@ -1193,7 +1339,22 @@ AstNode::Expr AstParser::buildIndex() {
 	node->token = start;
 
 	bool oldAssign = mayParseAssign;
-	auto index = buildExpr();
+	AstNode::Expr index;
+	if(peekIf(TokenType::Colon) ) {
+		index = std::make_unique<IntAstNode>(0);
+		index->token = start;
+	} else {
+		index = buildExpr();
+	}
+	if(index && getIf(TokenType::Colon) ) {	//Slice, a[lo:hi], a[:hi] or a[lo:]
+		node->isSlice = true;
+		if(!peekIf(TokenType::ArrayEnd) ) {
+			node->end = buildExpr();
+			if(!node->end) {
+				return toExpr(unexpected() );
+			}
+		}
+	}
 	mayParseAssign = oldAssign;
 
 	if(!index) {
@@ -1205,6 +1366,9 @@ AstNode::Expr AstParser::buildIndex() {
 	}
 
 	node->index = std::move(index);
+	if(node->isSlice) {	//A view is used as a whole, it is not indexed further here
+		return node;
+	}
 
 	auto child = buildIndex();
 	if(child) {
@@ -1219,10 +1383,29 @@ AstNode::Expr AstParser::buildIndex() {
 	return node;
 }
 
+//Vector types are named after their element type and lane count, e.g. int4 or float8
+static void splitVectorType(Type &type) {
+	static const std::string elements[] = {"char", "int", "float", "double", "bool"};
+	for(const auto &element : elements) {
+		if(type.name.size() <= element.size() || type.name.compare(0, element.size(), element) != 0) {
+			continue;
+		}
+
+		int lanes = 0;
+		if(isIntLiteral(type.name.substr(element.size() ), lanes) == NumValidity::Ok
+				&& Type::isLaneCount(lanes) ) {
+			type.name = element;
+			type.lanes = lanes;
+		}
+		return;
+	}
+}
+
 bool AstParser::buildType(Type &type) {
 	auto checkpoint = iterator;
 
 	if(getIf(TokenType::ArrayStart) ) {
+		type.isSlice = getIf(TokenType::Colon) != nullptr;
 		if(!getIf(TokenType::ArrayEnd) ) { 
 			iterator = checkpoint;
 			return false;
@@ -1230,6 +1413,11 @@ bool AstParser::buildType(Type &type) {
 		
 		if(getIf(TokenType::At) ) {
 			type.realignedArray = true;
+			if(auto tile = getIf(TokenType::IntLiteral) ) {	//Checked by the symbol pass
+				int tileSize = 0;
+				isIntLiteral(tile->value, tileSize);
+				type.tileSize = tileSize;
+			}
 		}
 
 		while(getIf(TokenType::Multiply) ) {
@@ -1253,6 +1441,7 @@ bool AstParser::buildType(Type &type) {
 	auto id = getIf(TokenType::Identifier);
 	if(id) {
 		type.name = id->value;
+		splitVectorType(type);
 		while(getIf(TokenType::Multiply) ) {
 			type.isPtr++;
 		}
@@ -38,6 +38,10 @@ void AstPrinter::visit(FunctionAstNode &node) {
 	Scope scope;
 	pad(scope.depth);
 	std::cerr << "Function : " << node.signature.name << '\n';
+	for(auto hint : node.hints) {
+		pad(scope.depth);
+		std::cerr << "hint: " << hint->value << '\n';
+	}
 	for(auto &c : node.children) {
 		c->accept(*this);
 	}
@@ -60,6 +64,11 @@ void AstPrinter::visit(VariableDeclareAstNode &node) {
 	for(auto &c : node.children) {
 		c->accept(*this);
 	}
+	if(node.allocator) {
+		pad(scope.depth);
+		std::cerr << "allocator:\n";
+		node.allocator->accept(*this);
+	}
 }
 
 void AstPrinter::visit(ReturnAstNode &node) {
@@ -81,10 +90,29 @@ void AstPrinter::visit(BranchAstNode &node) {
 	}
 }
 
+void AstPrinter::visit(ArenaAstNode &node) {
+	Scope scope;
+	pad(scope.depth);
+	std::cerr << "arena\n";
+	for(auto &c : node.children) {
+		c->accept(*this);
+	}
+}
+
 void AstPrinter::visit(LoopAstNode &node) {
 	Scope scope;
 	pad(scope.depth);
-	std::cerr << "while\nexpr:\n";
+	std::cerr << "while\n";
+	for(const auto &hint : node.hints) {
+		pad(scope.depth);
+		std::cerr << "hint: " << hint.token->value;
+		if(hint.count > 0) {
+			std::cerr << '(' << hint.count << ')';
+		}
+		std::cerr << '\n';
+	}
+	pad(scope.depth);
+	std::cerr << "expr:\n";
 	node.expr->accept(*this);
 	for(auto &c : node.children) {
 		c->accept(*this);
@@ -141,8 +169,11 @@ void AstPrinter::visit(ArrayAstNode &node) {
 void AstPrinter::visit(IndexAstNode &node) {
 	Scope scope;
 	pad(scope.depth);
-	std::cerr << "Index []\n";
+	std::cerr << (node.isSlice ? "Slice [:]\n" : "Index []\n");
 	node.index->accept(*this);
+	if(node.end) {
+		node.end->accept(*this);
+	}
 }
 
 void AstPrinter::visit(MemberVariableAstNode &node) {
@@ -175,6 +206,12 @@ void AstPrinter::visit(IntAstNode &node) {
 	std::cerr << "Int : " << node.value << '\n';
 }
 
+void AstPrinter::visit(FloatAstNode &node) {
+	Scope scope;
+	pad(scope.depth);
+	std::cerr << "Float : " << node.value << (node.isDouble ? "d" : "") << '\n';
+}
+
 void AstPrinter::visit(BoolAstNode &node) {
 	Scope scope;
 	pad(scope.depth);
@@ -0,0 +1,574 @@
+#include "effects.hpp"
+#include "global.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+bool EffectAnalysis::Effects::operator==(const Effects &rhs) const {
+	return reads == rhs.reads && writes == rhs.writes && otherMemory == rhs.otherMemory
+		&& frees == rhs.frees && unwinds == rhs.unwinds && mayNotReturn == rhs.mayNotReturn
+		&& fresh == rhs.fresh;
+}
+
+EffectAnalysis::EffectAnalysis(SymTable *symtable) : symtable(symtable) {
+
+}
+
+void EffectAnalysis::visit(ToplevelAstNode &node) {
+	collectFunctions(node);
+	for(const auto &func : functions) {
+		func.second->accept(*this);
+	}
+	finish();
+}
+
+void EffectAnalysis::visit(LinkAstNode &node) {
+
+}
+
+void EffectAnalysis::visit(StructAstNode &node) {
+
+}
+
+void EffectAnalysis::visit(FunctionAstNode &node) {
+	auto &sig = node.signature;
+	frames.emplace_back();
+	frames.back().summary.function = &node;
+	for(size_t i = 0; i < sig.parameters.size(); i++) {
+		frames.back().types[sig.paramNames[i]] = &sig.parameters[i];
+		frames.back().params.insert(sig.paramNames[i]);
+	}
+
+	for(const auto &child : node.children) {
+		writing = false;
+		child->accept(*this);
+	}
+
+	summaries[sig.name] = std::move(frames.back().summary);
+	frames.pop_back();
+}
+
+void EffectAnalysis::visit(ExternAstNode &node) {
+
+}
+
+void EffectAnalysis::visit(VariableDeclareAstNode &node) {
+	frames.back().types[node.identifier] = &node.type;
+	if(node.owned) {	//Freed when leaving its scope
+		allocate();
+	}
+
+	if(node.allocator) {	//Every allocation calls into the allocator, which is opaque
+		allocate();
+		frames.back().summary.direct.mayNotReturn = true;
+		writing = false;
+		node.allocator->accept(*this);
+	}
+
+	for(const auto &child : node.children) {
+		writing = false;
+		child->accept(*this);
+	}
+}
+
+void EffectAnalysis::visit(ReturnAstNode &node) {
+	auto &summary = frames.back().summary;
+	for(const auto &child : node.children) {
+		auto call = dynamic_cast<CallAstNode*>(child.get() );
+		if(call && !call->isCast) {
+			summary.returnedCalls.push_back(call->identifier);
+		} else {
+			summary.returnsOther = true;
+		}
+
+		writing = false;
+		child->accept(*this);
+	}
+}
+
+void EffectAnalysis::visit(BranchAstNode &node) {
+	writing = false;
+	node.expr->accept(*this);
+	for(const auto &child : node.children) {
+		writing = false;
+		child->accept(*this);
+	}
+}
+
+void EffectAnalysis::visit(ArenaAstNode &node) {
+	allocate();	//Enters and leaves the region of the thread
+	for(const auto &child : node.children) {
+		writing = false;
+		child->accept(*this);
+	}
+}
+
+void EffectAnalysis::visit(LoopAstNode &node) {
+	//Termination of loops is not proven
+	frames.back().summary.direct.mayNotReturn = true;
+
+	if(node.loopPrefix) {
+		writing = false;
+		node.loopPrefix->accept(*this);
+	}
+
+	writing = false;
+	node.expr->accept(*this);
+
+	if(node.loopSuffix) {
+		writing = false;
+		node.loopSuffix->accept(*this);
+	}
+
+	for(const auto &child : node.children) {
+		writing = false;
+		child->accept(*this);
+	}
+}
+
+void EffectAnalysis::visit(CallAstNode &node) {
+	if(SymTable::isLayoutQuery(node.identifier) ) {	//Arguments are names, never evaluated
+		return;
+	}
+
+	if(!node.isCast) {
+		Call call;
+		call.callee = node.identifier;
+		for(const auto &arg : node.children) {
+			if(arg) {
+				call.args.push_back(pointee(*arg) );
+			}
+		}
+		frames.back().summary.calls.push_back(std::move(call) );
+	}
+
+	for(const auto &arg : node.children) {
+		if(arg) {
+			writing = false;
+			arg->accept(*this);
+		}
+	}
+}
+
+void EffectAnalysis::visit(BinExpressionAstNode &node) {
+	if(node.type == TokenType::Push) {	//May have to grow the array
+		allocate();
+	}
+
+	if(node.type == TokenType::Assign || node.type == TokenType::Push) {
+		writing = true;
+		node.children.front()->accept(*this);
+		writing = false;
+		node.children.back()->accept(*this);
+		return;
+	}
+
+	for(const auto &child : node.children) {
+		writing = false;
+		child->accept(*this);
+	}
+}
+
+void EffectAnalysis::visit(UnaryExpressionAstNode &node) {
+	bool write = writing;
+	writing = false;
+
+	auto &child = *node.children.front();
+	auto var = dynamic_cast<VariableAstNode*>(&child);
+
+	//Where the array header of the operand is found
+	Memory header = Memory::Other;
+	if(var) {
+		const Type *type;
+		header = locate(*var, type);
+		if(type && type->isPtr > 0) {
+			header = var->children.empty() ? pointee(*var) : Memory::Other;
+		}
+	}
+
+	switch(node.type) {
+		case TokenType::And:
+			access(pointee(child), write);
+			break;
+		case TokenType::Ternary:
+			access(header, false);
+			break;
+		case TokenType::Pop:
+			access(header, true);
+			access(Memory::Other, false);
+			break;
+		case TokenType::Tilde:
+			if(var && var->children.empty()
+					&& frames.back().summary.function->stackArrays.count(var->name) > 0) {
+				break;	//Released along with the stack frame
+			}
+			allocate();
+			access(header, true);
+			break;
+		default:
+			break;
+	}
+
+	child.accept(*this);
+}
+
+void EffectAnalysis::visit(CastExpressionAstNode &node) {
+	for(const auto &child : node.children) {
+		writing = false;
+		child->accept(*this);
+	}
+}
+
+void EffectAnalysis::visit(ArrayAstNode &node) {
+	if(node.stackLength == 0) {
+		allocate();
+	}
+
+	if(node.length) {
+		writing = false;
+		node.length->accept(*this);
+	}
+}
+
+void EffectAnalysis::visit(IndexAstNode &node) {
+	if(Global::config.boundsChecks) {	//A failing check reports to stderr and traps
+		auto &direct = frames.back().summary.direct;
+		direct.writes = direct.otherMemory = direct.mayNotReturn = true;
+	}
+
+	writing = false;
+	node.index->accept(*this);
+	if(node.end) {
+		writing = false;
+		node.end->accept(*this);
+	}
+	for(const auto &child : node.children) {
+		writing = false;
+		child->accept(*this);
+	}
+}
+
+void EffectAnalysis::visit(MemberVariableAstNode &node) {
+	for(const auto &child : node.children) {
+		writing = false;
+		child->accept(*this);
+	}
+}
+
+void EffectAnalysis::visit(VariableAstNode &node) {
+	bool write = writing;
+	writing = false;
+
+	//The variable itself lives in an alloca, only indexing and members reach further
+	if(node.children.empty() ) {
+		return;
+	}
+
+	const Type *type;
+	access(locate(node, type), write);
+	for(const auto &child : node.children) {
+		writing = false;
+		child->accept(*this);
+	}
+}
+
+void EffectAnalysis::visit(StringAstNode &node) {
+
+}
+
+void EffectAnalysis::visit(IntAstNode &node) {
+
+}
+
+void EffectAnalysis::visit(FloatAstNode &node) {
+
+}
+
+void EffectAnalysis::visit(BoolAstNode &node) {
+
+}
+
+void EffectAnalysis::collectFunctions(ToplevelAstNode &node) {
+	for(auto func : node.functions) {
+		functions.insert({func->signature.name, func});
+	}
+	for(auto ext : node.externs) {
+		externs.insert({ext->name, ext});
+	}
+	for(auto toplevel : node.toplevels) {
+		collectFunctions(*toplevel);
+	}
+}
+
+void EffectAnalysis::finish() {
+	//Start out optimistic and add the effects of callees until nothing changes
+	std::unordered_set<std::string> recursive;
+	for(const auto &func : functions) {
+		Effects start;
+		start.fresh = true;
+		effects[func.first] = start;
+
+		if(isRecursive(func.first) ) {
+			recursive.insert(func.first);
+		}
+	}
+
+	for(bool changed = true; changed; ) {
+		changed = false;
+		for(const auto &func : functions) {
+			auto &summary = summaries[func.first];
+			Effects result = summary.direct;
+			result.mayNotReturn |= recursive.count(func.first) > 0;
+
+			for(const auto &call : summary.calls) {
+				Effects callee = calleeEffects(call.callee);
+				result.frees |= callee.frees;
+				result.unwinds |= callee.unwinds;
+				result.mayNotReturn |= callee.mayNotReturn;
+				if(!callee.reads && !callee.writes) {
+					continue;
+				}
+
+				//Memory handed to the callee through pointers, plus whatever else it touches
+				auto reached = call.args;
+				if(callee.otherMemory) {
+					reached.push_back(Memory::Other);
+				}
+
+				for(auto memory : reached) {
+					if(memory == Memory::Local) {
+						continue;
+					}
+					result.reads |= callee.reads;
+					result.writes |= callee.writes;
+					result.otherMemory |= memory == Memory::Other;
+				}
+			}
+
+			result.fresh = !summary.returnsOther && !summary.returnedCalls.empty()
+				&& std::all_of(summary.returnedCalls.begin(), summary.returnedCalls.end(),
+					[&](const std::string &callee) {
+						return calleeEffects(callee).fresh;
+					});
+
+			if(!(result == effects[func.first]) ) {
+				effects[func.first] = result;
+				changed = true;
+			}
+		}
+	}
+
+	for(const auto &func : functions) {
+		auto &sig = func.second->signature;
+		func.second->attributes = attributesOf(effects[func.first], sig.returnType);
+
+		if(Global::config.verbose) {
+			std::cerr << "Function '" << sig.name << "' inferred as";
+			for(const auto &attribute : func.second->attributes) {
+				std::cerr << ' ' << attribute;
+			}
+			std::cerr << '\n';
+		}
+	}
+}
+
+bool EffectAnalysis::isRecursive(const std::string &name) const {
+	std::unordered_set<std::string> seen;
+	std::vector<std::string> pending = {name};
+	while(!pending.empty() ) {
+		auto current = std::move(pending.back() );
+		pending.pop_back();
+
+		auto it = summaries.find(current);
+		if(it == summaries.end() ) {	//Externs never call back into us
+			continue;
+		}
+
+		for(const auto &call : it->second.calls) {
+			if(call.callee == name) {
+				return true;
+			}
+			if(seen.insert(call.callee).second) {
+				pending.push_back(call.callee);
+			}
+		}
+	}
+	return false;
+}
+
+EffectAnalysis::Effects EffectAnalysis::calleeEffects(const std::string &callee) const {
+	auto func = effects.find(callee);
+	if(func != effects.end() ) {
+		return func->second;
+	}
+
+	auto ext = externs.find(callee);
+	if(ext != externs.end() ) {
+		return externEffects(*ext->second);
+	}
+
+	if(callee == "clone" || callee == "transpose") {	//Reads the source into a new allocation
+		Effects clone;
+		clone.reads = clone.writes = clone.otherMemory = true;
+		return clone;
+	}
+
+	if(callee == "reserve" || callee == "append" || callee == "resize" || callee == "shrink" || callee == "copy") {
+		Effects array;	//Reallocates the array, through the heap
+		array.reads = array.writes = array.otherMemory = array.frees = true;
+		return array;
+	}
+
+	if(SymTable::isBuiltin(callee) ) {	//Vector builtins only touch the element they are given
+		Effects builtin;
+		builtin.reads = callee == "loadLanes" || callee == "loadMasked";
+		builtin.writes = callee == "storeLanes" || callee == "storeMasked";
+		return builtin;
+	}
+
+	Effects unknown;
+	unknown.reads = unknown.writes = unknown.otherMemory = true;
+	unknown.frees = unknown.unwinds = unknown.mayNotReturn = true;
+	return unknown;
+}
+
+EffectAnalysis::Effects EffectAnalysis::externEffects(const ExternAstNode &ext) const {
+	auto has = [&](const std::string &name) {
+		return std::any_of(ext.attributes.begin(), ext.attributes.end(), [&](Token *attribute) {
+			return attribute->value == name;
+		});
+	};
+
+	//Anything not promised by an attribute is assumed to happen
+	Effects result;
+	if(!has("readnone") ) {
+		result.reads = !has("writeonly");
+		result.writes = !has("readonly");
+		result.otherMemory = !has("argmemonly");
+	}
+	result.frees = result.writes && !has("nofree");
+	result.unwinds = !has("nounwind");
+	result.mayNotReturn = !has("willreturn");
+	result.fresh = has("noalias");
+	return result;
+}
+
+std::vector<std::string> EffectAnalysis::attributesOf(const Effects &effects,
+		const Type &returnType) const {
+	std::vector<std::string> result;
+	if(!effects.unwinds) {
+		result.push_back("nounwind");
+	}
+
+	if(!effects.reads && !effects.writes) {
+		result.push_back("readnone");
+	} else if(!effects.writes) {
+		result.push_back("readonly");
+	}
+
+	if((effects.reads || effects.writes) && !effects.otherMemory) {
+		result.push_back("argmemonly");
+	}
+
+	if(!effects.frees) {
+		result.push_back("nofree");
+	}
+
+	if(!effects.mayNotReturn) {
+		result.push_back("willreturn");
+	}
+
+	if(effects.fresh && returnType.isPtr > 0) {
+		result.push_back("noalias");
+	}
+	return result;
+}
+
+void EffectAnalysis::access(Memory memory, bool write) {
+	if(memory == Memory::Local) {
+		return;
+	}
+
+	auto &direct = frames.back().summary.direct;
+	(write ? direct.writes : direct.reads) = true;
+	direct.otherMemory |= memory == Memory::Other;
+}
+
+void EffectAnalysis::allocate() {
+	//malloc, realloc and free keep their bookkeeping out of our reach
+	auto &direct = frames.back().summary.direct;
+	direct.reads = direct.writes = direct.otherMemory = direct.frees = true;
+}
+
+EffectAnalysis::Memory EffectAnalysis::locate(VariableAstNode &node, const Type *&type) const {
+	auto &frame = frames.back();
+	auto it = frame.types.find(node.name);
+	if(it == frame.types.end() ) {
+		type = nullptr;
+		return Memory::Other;
+	}
+	type = it->second;
+
+	bool isParam = frame.params.count(node.name) > 0;
+	bool onStack = frame.summary.function->stackArrays.count(node.name) > 0;
+	Memory memory = Memory::Local;
+	AstNode *link = node.children.empty() ? nullptr : node.children.front().get();
+	for(bool first = true; link; first = false) {
+		if(!type) {
+			return Memory::Other;
+		}
+
+		if(auto member = dynamic_cast<MemberVariableAstNode*>(link) ) {
+			if(type->isPtr > 0) {	//Member reached through a pointer
+				memory = first && isParam && type->isPtr == 1 ? Memory::Argument : Memory::Other;
+			}
+			type = symtable->typeHasMember(*type, member->name);
+		} else if(auto index = dynamic_cast<IndexAstNode*>(link) ) {
+			if(!first || !onStack || type->isPtr > 0) {	//Elements live on the heap
+				memory = Memory::Other;
+			}
+			if(!index->isSlice) {	//A slice views the same elements as a whole
+				type = type->arrayOf ? type->arrayOf.get() : nullptr;
+			}
+		} else {
+			return Memory::Other;
+		}
+
+		link = link->children.empty() ? nullptr : link->children.front().get();
+	}
+	return memory;
+}
+
+EffectAnalysis::Memory EffectAnalysis::pointee(AstNode &arg) const {
+	if(auto var = dynamic_cast<VariableAstNode*>(&arg) ) {
+		const Type *type;
+		locate(*var, type);
+		if(!type) {
+			return Memory::Other;
+		} else if(type->isPtr == 0) {	//Passed by value
+			return Memory::Local;
+		}
+
+		bool isParam = frames.back().params.count(var->name) > 0;
+		return var->children.empty() && isParam ? Memory::Argument : Memory::Other;
+	}
+
+	if(auto un = dynamic_cast<UnaryExpressionAstNode*>(&arg) ) {
+		auto var = dynamic_cast<VariableAstNode*>(un->children.front().get() );
+		if(un->type == TokenType::Multiply && var) {	//Address of whatever is named
+			const Type *type;
+			return locate(*var, type);
+		}
+		return Memory::Other;
+	}
+
+	if(auto cast = dynamic_cast<CastExpressionAstNode*>(&arg) ) {
+		return pointee(*cast->children.front() );
+	}
+
+	if(dynamic_cast<IntAstNode*>(&arg) || dynamic_cast<FloatAstNode*>(&arg) || dynamic_cast<BoolAstNode*>(&arg)
+			|| dynamic_cast<ArrayAstNode*>(&arg) ) {
+		return Memory::Local;
+	}
+	return Memory::Other;
+}
@@ -0,0 +1,548 @@
+#include "escape.hpp"
+#include "global.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <iostream>
+
+//Variable viewed as a whole through a slice, e.g. values[lo:hi]
+static VariableAstNode *slicedVariable(AstNode *node) {
+	auto var = dynamic_cast<VariableAstNode*>(node);
+	auto index = var && !var->children.empty() ? dynamic_cast<IndexAstNode*>(var->children.front().get() ) : nullptr;
+	return index && index->isSlice ? var : nullptr;
+}
+
+//Builtins moving their first argument's elements to a new allocation
+static bool reallocates(const std::string &callee) {
+	return callee == "reserve" || callee == "append" || callee == "resize" || callee == "shrink" || callee == "copy";
+}
+
+EscapeAnalysis::EscapeAnalysis(SymTable *symtable) : symtable(symtable) {
+
+}
+
+void EscapeAnalysis::visit(ToplevelAstNode &node) {
+	collectFunctions(node);
+	for(const auto &child : node.children) {
+		child->accept(*this);
+	}
+}
+
+void EscapeAnalysis::visit(LinkAstNode &node) {
+
+}
+
+void EscapeAnalysis::visit(StructAstNode &node) {
+
+}
+
+void EscapeAnalysis::visit(FunctionAstNode &node) {
+	//May already have been analyzed when summarizing a callee
+	if(escapingParams.count(node.signature.name) == 0) {
+		analyze(node);
+	}
+}
+
+void EscapeAnalysis::visit(ExternAstNode &node) {
+
+}
+
+void EscapeAnalysis::visit(VariableDeclareAstNode &node) {
+	auto &frame = frames.back();
+	frame.types[node.identifier] = &node.type;
+	if(node.allocator) {
+		frame.allocated.insert(node.identifier);
+		use = Use::Value;
+		node.allocator->accept(*this);
+	} else if(node.region) {
+		frame.allocated.insert(node.identifier);
+		frame.regional[node.identifier] = frame.arenaDepth;
+	}
+
+	if(node.children.empty() ) {
+		return;
+	}
+
+	//First child is binary expr (assignment), assignments rhs is the initializer
+	auto &init = node.children.front()->children.back();
+	auto array = dynamic_cast<ArrayAstNode*>(init.get() );
+	if(array && array->length && node.type.arrayOf && node.type.isPtr == 0 && !node.allocator && !node.region) {
+		frame.candidates[node.identifier] = array;
+		frame.order.push_back(node.identifier);
+	} else if(node.type.name == "int" && node.type.isPtr == 0) {
+		frame.constants[node.identifier] = init.get();
+	}
+
+	//A slice of a region array is bound to the block just the same
+	auto sliced = slicedVariable(init.get() );
+	if(sliced && frame.regional.count(sliced->name) > 0) {
+		frame.regional[node.identifier] = frame.regional[sliced->name];
+		lent = true;
+	}
+
+	use = Use::Value;
+	init->accept(*this);
+	lent = false;
+}
+
+void EscapeAnalysis::visit(ReturnAstNode &node) {
+	for(const auto &child : node.children) {
+		use = Use::Value;
+		child->accept(*this);
+	}
+}
+
+void EscapeAnalysis::visit(BranchAstNode &node) {
+	use = Use::Value;
+	node.expr->accept(*this);
+	for(const auto &child : node.children) {
+		use = Use::Value;
+		child->accept(*this);
+	}
+}
+
+void EscapeAnalysis::visit(ArenaAstNode &node) {
+	frames.back().arenaDepth++;
+	for(const auto &child : node.children) {
+		use = Use::Value;
+		child->accept(*this);
+	}
+	frames.back().arenaDepth--;
+}
+
+void EscapeAnalysis::visit(LoopAstNode &node) {
+	if(node.loopPrefix) {
+		use = Use::Value;
+		node.loopPrefix->accept(*this);
+	}
+
+	use = Use::Value;
+	node.expr->accept(*this);
+
+	if(node.loopSuffix) {
+		use = Use::Value;
+		node.loopSuffix->accept(*this);
+	}
+
+	for(const auto &child : node.children) {
+		use = Use::Value;
+		child->accept(*this);
+	}
+}
+
+void EscapeAnalysis::visit(CallAstNode &node) {
+	if(SymTable::isLayoutQuery(node.identifier) ) {	//Arguments are names, never evaluated
+		return;
+	}
+
+	for(size_t i = 0; i < node.children.size(); i++) {
+		auto &arg = node.children[i];
+		if(!arg) {
+			continue;
+		}
+
+		//A slice handed over as an array must not be grown, freed or kept by the callee
+		auto sig = symtable->hasFunc(node.identifier);
+		bool toArray = sig && i < sig->parameters.size() && sig->parameters[i].arrayOf
+			&& !sig->parameters[i].isSlice;
+		if(toArray && isSliceValue(*arg) && paramMayEscape(node.identifier, i) ) {
+			Global::errStack.push("Cannot pass a slice to '" + node.identifier
+				+ "', it may grow, free or keep its array parameter", node.token);
+		}
+
+		//Arrays lent to a callee that does not hold on to them stay local
+		auto name = borrowedArray(*arg);
+		if(!name.empty() && !paramMayEscape(node.identifier, i) ) {
+			continue;
+		}
+
+		//Builtins copy elements in or out, the array itself stays with the caller
+		auto var = dynamic_cast<VariableAstNode*>(arg.get() );
+		lent = (!name.empty() || (var && var->children.empty() ) )
+			&& (SymTable::isBuiltin(node.identifier) || !paramMayEscape(node.identifier, i) );
+		grown = i == 0 && reallocates(node.identifier);
+		use = Use::Value;
+		arg->accept(*this);
+		lent = false;
+		grown = false;
+	}
+}
+
+void EscapeAnalysis::visit(BinExpressionAstNode &node) {
+	if(node.type == TokenType::Assign || node.type == TokenType::Push) {
+		use = node.type == TokenType::Assign ? Use::Assign : Use::Push;
+		node.children.front()->accept(*this);
+		use = Use::Value;
+		node.children.back()->accept(*this);
+		return;
+	}
+
+	for(const auto &child : node.children) {
+		use = Use::Value;
+		child->accept(*this);
+	}
+}
+
+void EscapeAnalysis::visit(UnaryExpressionAstNode &node) {
+	Use childUse;
+	switch(node.type) {
+		case TokenType::Multiply:
+			childUse = Use::Address;
+			break;
+		case TokenType::Ternary:
+		case TokenType::Pop:
+			childUse = Use::Inspect;
+			break;
+		case TokenType::Tilde:
+			childUse = Use::Free;
+			break;
+		default:
+			childUse = Use::Value;
+			break;
+	}
+
+	for(const auto &child : node.children) {
+		use = childUse;
+		child->accept(*this);
+	}
+}
+
+void EscapeAnalysis::visit(CastExpressionAstNode &node) {
+	for(const auto &child : node.children) {
+		use = Use::Value;
+		child->accept(*this);
+	}
+}
+
+void EscapeAnalysis::visit(ArrayAstNode &node) {
+	if(node.length) {
+		use = Use::Value;
+		node.length->accept(*this);
+	}
+}
+
+void EscapeAnalysis::visit(IndexAstNode &node) {
+	use = Use::Value;
+	node.index->accept(*this);
+	if(node.end) {
+		use = Use::Value;
+		node.end->accept(*this);
+	}
+	for(const auto &child : node.children) {
+		use = Use::Value;
+		child->accept(*this);
+	}
+}
+
+void EscapeAnalysis::visit(MemberVariableAstNode &node) {
+	for(const auto &child : node.children) {
+		use = Use::Value;
+		child->accept(*this);
+	}
+}
+
+void EscapeAnalysis::visit(VariableAstNode &node) {
+	auto parentUse = use;
+	bool isLent = lent;
+	bool isGrown = grown || parentUse == Use::Push;
+	use = Use::Value;
+	lent = false;
+	grown = false;
+
+	//Indexing or member access only touches the elements, never the array itself
+	auto sliced = slicedVariable(&node);
+	if(!node.children.empty() && !sliced) {
+		for(const auto &child : node.children) {
+			use = Use::Value;
+			child->accept(*this);
+		}
+		return;
+	}
+
+	//A slice shares the elements, it is used like the array itself
+	if(sliced) {
+		auto &slice = static_cast<IndexAstNode&>(*node.children.front() );
+		use = Use::Value;
+		slice.index->accept(*this);
+		if(slice.end) {
+			use = Use::Value;
+			slice.end->accept(*this);
+		}
+	}
+
+	//Storage from an allocator goes back through it, so the array must stay where it was declared
+	auto &frame = frames.back();
+	bool isKept = (parentUse == Use::Value || parentUse == Use::Address) && !isLent;
+	bool isReassigned = parentUse == Use::Assign && frame.allocated.count(node.name) > 0 && !sliced;
+	if(frame.regional.count(node.name) > 0 && (isKept || isReassigned) ) {
+		Global::errStack.push("'" + node.name + "' lives in an arena block, it may not be moved, reassigned "
+			"or passed to a function that may keep it", node.token);
+	} else if(frame.allocated.count(node.name) > 0 && !sliced && (isKept || isReassigned) ) {
+		Global::errStack.push("Array '" + node.name + "' has an allocator, it may not be moved, reassigned "
+			"or passed to a function that may keep it", node.token);
+	}
+
+	//Growing would place the elements in the inner block's region, released before the array is
+	auto region = frame.regional.find(node.name);
+	if(isGrown && region != frame.regional.end() && region->second < frame.arenaDepth) {
+		Global::errStack.push("'" + node.name + "' lives in an outer arena block, it may not grow "
+			"inside a nested one", node.token);
+	}
+
+	bool isParam = frame.params.count(node.name) > 0;
+	if(parentUse == Use::Inspect || (parentUse == Use::Free && !isParam) ) {
+		return;
+	}
+
+	if(parentUse == Use::Assign || parentUse == Use::Address) {
+		frame.reassigned.insert(node.name);
+	}
+	frame.escaped.insert(node.name);
+}
+
+void EscapeAnalysis::visit(StringAstNode &node) {
+
+}
+
+void EscapeAnalysis::visit(IntAstNode &node) {
+
+}
+
+void EscapeAnalysis::visit(FloatAstNode &node) {
+
+}
+
+void EscapeAnalysis::visit(BoolAstNode &node) {
+
+}
+
+void EscapeAnalysis::collectFunctions(ToplevelAstNode &node) {
+	for(auto func : node.functions) {
+		functions.insert({func->signature.name, func});
+	}
+	for(auto toplevel : node.toplevels) {
+		collectFunctions(*toplevel);
+	}
+}
+
+void EscapeAnalysis::analyze(FunctionAstNode &node) {
+	auto &sig = node.signature;
+
+	//Assume the worst while the function is in progress, this covers recursion
+	escapingParams[sig.name] = std::vector<bool>(sig.parameters.size(), true);
+
+	auto oldUse = use;
+	frames.emplace_back();
+	frames.back().function = &node;
+	for(size_t i = 0; i < sig.parameters.size(); i++) {
+		frames.back().types[sig.paramNames[i]] = &sig.parameters[i];
+		frames.back().params[sig.paramNames[i]] = i;
+	}
+
+	for(const auto &child : node.children) {
+		use = Use::Value;
+		child->accept(*this);
+	}
+
+	Frame frame = std::move(frames.back() );
+	frames.pop_back();
+	use = oldUse;
+
+	finish(frame);
+}
+
+void EscapeAnalysis::finish(Frame &frame) {
+	auto &sig = frame.function->signature;
+	auto &params = escapingParams[sig.name];
+	for(const auto &param : frame.params) {
+		params[param.second] = frame.escaped.count(param.first) > 0;
+	}
+	frame.function->keptParams = params;
+
+	unsigned frameBytes = 0;
+	for(const auto &name : frame.order) {
+		if(frame.escaped.count(name) > 0) {
+			continue;
+		}
+
+		auto array = frame.candidates[name];
+		int length;
+		if(!evaluate(array->length.get(), frame, length) || length <= 0) {
+			continue;
+		}
+
+		long long bytes = static_cast<long long>(length) * sizeOf(*array->type.arrayOf);
+		if(bytes > maxArrayBytes || frameBytes + bytes > maxFrameBytes) {
+			continue;
+		}
+
+		frameBytes += bytes;
+		array->stackLength = length;
+		frame.function->stackArrays.insert(name);
+
+		if(Global::config.verbose || Global::config.verboseEscape) {
+			std::cerr << "Array '" << name << "' in '" << sig.name << "' does not escape, "
+				<< bytes << " bytes placed on the stack\n";
+		}
+	}
+}
+
+bool EscapeAnalysis::paramMayEscape(const std::string &callee, size_t index) {
+	auto it = functions.find(callee);
+	if(it == functions.end() ) {	//Externs are opaque
+		return true;
+	}
+
+	if(escapingParams.count(callee) == 0) {
+		analyze(*it->second);
+	}
+
+	auto &params = escapingParams[callee];
+	return index >= params.size() || params[index];
+}
+
+bool EscapeAnalysis::isSliceValue(AstNode &arg) const {
+	if(slicedVariable(&arg) ) {
+		return true;
+	}
+
+	if(auto call = dynamic_cast<CallAstNode*>(&arg) ) {
+		auto sig = symtable->hasFunc(call->identifier);
+		return sig && sig->returnType.isSlice;
+	}
+
+	auto var = dynamic_cast<VariableAstNode*>(&arg);
+	auto &types = frames.back().types;
+	auto it = var && var->children.empty() ? types.find(var->name) : types.end();
+	return it != types.end() && it->second->isSlice;
+}
+
+std::string EscapeAnalysis::borrowedArray(AstNode &arg) const {
+	auto &types = frames.back().types;
+	auto isArray = [&](AstNode *node, unsigned isPtr) {
+		auto var = dynamic_cast<VariableAstNode*>(node);
+		if(!var || !var->children.empty() ) {
+			return false;
+		}
+		auto it = types.find(var->name);
+		return it != types.end() && it->second->arrayOf && it->second->isPtr == isPtr;
+	};
+
+	//*array
+	auto un = dynamic_cast<UnaryExpressionAstNode*>(&arg);
+	if(un && un->type == TokenType::Multiply && isArray(un->children.front().get(), 0) ) {
+		return static_cast<VariableAstNode*>(un->children.front().get() )->name;
+	}
+
+	//Array pointer handed along to yet another callee
+	if(isArray(&arg, 1) ) {
+		return static_cast<VariableAstNode&>(arg).name;
+	}
+
+	//array[lo:hi]
+	auto sliced = slicedVariable(&arg);
+	auto it = sliced ? types.find(sliced->name) : types.end();
+	if(it != types.end() && it->second->arrayOf && it->second->isPtr == 0) {
+		return sliced->name;
+	}
+
+	return "";
+}
+
+bool EscapeAnalysis::evaluate(AstNode *expr, const Frame &frame, int &value) const {
+	if(auto integer = dynamic_cast<IntAstNode*>(expr) ) {
+		if(integer->value < INT_MIN || integer->value > INT_MAX) {
+			return false;
+		}
+		value = integer->value;
+		return true;
+	}
+
+	if(auto var = dynamic_cast<VariableAstNode*>(expr) ) {
+		auto it = frame.constants.find(var->name);
+		if(!var->children.empty() || it == frame.constants.end()
+				|| frame.reassigned.count(var->name) > 0) {
+			return false;
+		}
+		return evaluate(it->second, frame, value);
+	}
+
+	auto bin = dynamic_cast<BinExpressionAstNode*>(expr);
+	int lhs, rhs;
+	if(!bin || !evaluate(bin->children.front().get(), frame, lhs)
+			|| !evaluate(bin->children.back().get(), frame, rhs) ) {
+		return false;
+	}
+
+	long long result;
+	switch(bin->type) {
+		case TokenType::Add:
+			result = static_cast<long long>(lhs) + rhs;
+			break;
+		case TokenType::Subtract:
+			result = static_cast<long long>(lhs) - rhs;
+			break;
+		case TokenType::Multiply:
+			result = static_cast<long long>(lhs) * rhs;
+			break;
+		case TokenType::Divide:
+			if(rhs == 0) {
+				return false;
+			}
+			result = lhs / rhs;
+			break;
+		default:
+			return false;
+	}
+
+	if(result < INT_MIN || result > INT_MAX) {
+		return false;
+	}
+	value = static_cast<int>(result);
+	return true;
+}
+
+unsigned EscapeAnalysis::sizeOf(const Type &type) const {
+	if(type.isPtr > 0) {
+		return 8;
+	}
+
+	if(type.arrayOf) {
+		return 8 + 8 + 8;
+	}
+
+	if(Type::isPrimitive(type.name) ) {
+		return type.size();
+	}
+
+	unsigned sum = 0;
+	unsigned align = 1;
+	auto struc = symtable->hasStruct(type.name);
+	if(struc) {
+		for(const auto &member : struc->members) {
+			unsigned memberAlign = alignOf(member.type);
+			sum = (sum + memberAlign - 1) / memberAlign * memberAlign + sizeOf(member.type);
+			align = std::max(align, memberAlign);
+		}
+	}
+	return (sum + align - 1) / align * align;
+}
+
+unsigned EscapeAnalysis::alignOf(const Type &type) const {
+	if(type.isPtr > 0 || type.arrayOf) {
+		return 8;
+	}
+
+	if(Type::isPrimitive(type.name) ) {
+		return type.alignment();
+	}
+
+	unsigned align = 1;
+	auto struc = symtable->hasStruct(type.name);
+	if(struc) {
+		for(const auto &member : struc->members) {
+			align = std::max(align, alignOf(member.type) );
+		}
+	}
+	return align;
+}
@@ -75,6 +75,8 @@ AstNode::Root performFrontendWork(const std::string &module, SymTable *symtable)
 		exit(EXIT_FAILURE);
 	}
 
+	ast->file = filename;
+
 	if(Global::config.verbose || Global::config.verboseAst) {
 		AstPrinter().visit(*ast);
 	}
@@ -13,7 +13,7 @@ Tokens &&Lexer::lexTokens(const std::string &str) {
 	auto start = iterator;
 	Token current;
 
-	int idummy;
+	long long idummy;
 	float fdummy;
 	NumValidity validity;
 
@@ -72,7 +72,9 @@ SEEK_TOKEN_END:	//Iterate until end of token
 	start = iterator;
 	if(isalnum(*iterator) ) {
 		//TODO: Account for step
-		while(!std::isspace(*iterator) && (isalnum(*iterator) || *iterator == '_') ) {
+		const bool number = std::isdigit(*iterator);
+		while(!std::isspace(*iterator) && (isalnum(*iterator) || *iterator == '_'
+				|| (number && isFloatPart(start, end) ) ) ) {
 			if(++iterator == end) {
 				--iterator;
 				goto TOKEN_TEST;
@@ -125,8 +127,13 @@ INTEGER_TEST:	//Test if token is integer literal
 	} else {	//TODO: Add error handling
 	}
 
-FLOAT_TEST:	//Test if token is floating point literal
-	validity = isFloatLiteral(current.value, fdummy);
+FLOAT_TEST:	//Test if token is floating point literal, 'd' suffix marks a double
+	if(std::isdigit(current.value.front() ) && current.value.find_first_of("xX") == std::string::npos) {
+		validity = isFloatLiteral(endsWith(current.value, "d") 
+			? current.value.substr(0, current.value.size() - 1) : current.value, fdummy);
+	} else {
+		validity = NumValidity::Invalid;
+	}
 	if(validity == NumValidity::Ok) {
 		current.type = TokenType::FloatLiteral;
 		goto INSERT_TOKEN;
@@ -187,6 +194,26 @@ int Lexer::get() const {
 	return *iterator;
 }
 
+//Whether a fraction point or exponent sign continues the numeric token begun at start
+bool Lexer::isFloatPart(std::string::const_iterator start, std::string::const_iterator end) const {
+	auto next = std::next(iterator);
+	if(next == end || !std::isdigit(*next) || std::find_if(start, iterator, [](char c) {
+				return c == 'x' || c == 'X';
+			}) != iterator) {
+		return false;
+	}
+
+	if(*iterator == '.') {
+		return std::find_if(start, iterator, [](char c) {
+			return c == '.' || c == 'e' || c == 'E';
+		}) == iterator;
+	} else if(*iterator == '+' || *iterator == '-') {
+		auto prev = std::prev(iterator);
+		return *prev == 'e' || *prev == 'E';
+	}
+	return false;
+}
+
 void Lexer::expand(std::string &str) {
 	for(auto it = std::find(str.begin(), str.end(), '\\');
 			it != str.end(); it = std::find(it, str.end(), '\\') ) {
@@ -6,8 +6,12 @@
 //#include "llvm/ADT/VariadicFunction.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Verifier.h"
@@ -26,9 +30,23 @@
 #include <llvm/Support/FormattedStream.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/IR/LegacyPassManager.h>
-
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/Transforms/IPO.h>
+#include <llvm/Transforms/IPO/AlwaysInliner.h>
+#include <llvm/Transforms/IPO/PassManagerBuilder.h>
+#include <llvm/Transforms/Scalar.h>
+#include <llvm/Transforms/Utils.h>
+
+#include <climits>
+#include <filesystem>
 #include <iostream>
 
+//Install location of libghoulrt, set by the build
+#ifndef GHOUL_RUNTIME_DIR
+#define GHOUL_RUNTIME_DIR "/usr/local/lib"
+#endif
+
 void LLVMCodeGen::setModuleInfo(ModuleInfo *mi) {
 	this->mi = mi;
 }
@@ -37,33 +55,134 @@ void LLVMCodeGen::setContext(Context *ctx) {
 	this->ctx = ctx;
 }
 
+//Whether the symbol pass found the expression to be an unsigned integer
+static bool isUnsigned(const AstNode &expr) {
+	auto expression = dynamic_cast<const ExpressionAstNode*>(&expr);
+	return expression && expression->isUnsigned;
+}
+
 void LLVMCodeGen::visit(ToplevelAstNode &node) {
 	FunctionAstNode *main = nullptr;
 	prepareToplevelNode(node);
 
+	auto oldFile = currentFile;
+	currentFile = node.file;
 	for(const auto &child : node.children) {
 		child->accept(*this);
 	}
+	currentFile = oldFile;
+}
+
+uint64_t LLVMCodeGen::layoutQuery(CallAstNode &node) {
+	//Constants of the target layout, the arguments were checked to name a type, a member or a variable
+	const auto &layout = mi->module->getDataLayout();
+	const auto &typeName = static_cast<VariableAstNode*>(node.children.front().get() )->name;
+	auto struc = mi->symtable->hasStruct(typeName);
+	Type type;
+	if(Type::isPrimitive(typeName) || struc) {
+		type.name = typeName;
+	} else {
+		type = *mi->symtable->getLocal(typeName);
+	}
+
+	auto llvmType = translateType(type);
+	if(node.identifier == "sizeof") {
+		return layout.getTypeAllocSize(llvmType);
+	} else if(node.identifier == "alignof") {
+		return layout.getABITypeAlignment(llvmType);
+	}
+
+	const auto &member = static_cast<VariableAstNode*>(node.children[1].get() )->name;
+	unsigned index = 0;
+	while(struc->members[index].identifier != member) {
+		index++;
+	}
+	return layout.getStructLayout(structTypes[typeName])->getElementOffset(index);
 }
 
 void LLVMCodeGen::visit(StructAstNode &node) {
+	if(!structTypes[node.name]->isOpaque() ) {	//Already laid out for a signature
+		return;
+	}
 
-	std::vector<llvm::Type*> types;
+	//Nested structs are laid out first, their size and alignment are needed below
 	Type *struc = mi->symtable->hasStruct(node.name);
+	const auto &layout = mi->module->getDataLayout();
+	std::unordered_map<std::string, std::pair<uint64_t, uint64_t>> sizes;	//Alignment and size
+	for(const auto &member : struc->members) {
+		const auto &type = member.type;
+		auto nested = structNodes.find(type.name);
+		if(type.isPtr == 0 && !type.arrayOf && nested != structNodes.end() && nested->second != &node) {
+			visit(*nested->second);
+		}
 
+		auto llvmType = translateType(type);
+		sizes[member.identifier] = {layout.getABITypeAlignment(llvmType), layout.getTypeAllocSize(llvmType)};
+	}
+
+	//Decreasing alignment leaves padding only at the end. Hot members go first and cold ones last,
+	//which orders []@ columns, plain arrays still stride over whole structs
 	if(!node.isVolatile) {
 		auto &members = struc->members;
-		std::sort(members.begin(), members.end(), [](Member &lhs, Member &rhs) {
-			return lhs.type.size() > rhs.type.size();
+		std::sort(members.begin(), members.end(), [&](Member &lhs, Member &rhs) {
+			if(lhs.heat != rhs.heat) {
+				return lhs.heat < rhs.heat;
+			}
+			auto &left = sizes[lhs.identifier];
+			auto &right = sizes[rhs.identifier];
+			return left.first != right.first ? left.first > right.first : left.second > right.second;
 		});
 	}
 
+	std::vector<llvm::Type*> types;
 	types.reserve(struc->members.size() );
 	for(auto it = struc->members.begin(); it != struc->members.end(); it++) {
 		types.push_back(translateType(it->type) );
 	}
 
 	structTypes[node.name]->setBody(types);
+	if(Global::config.layoutReport) {
+		reportLayout(*struc);
+	}
+}
+
+void LLVMCodeGen::reportLayout(const Type &struc) {
+	//Offsets, holes left for alignment and the cache lines every member spans
+	const uint64_t lineSize = 64;
+	auto type = structTypes[struc.name];
+	auto structLayout = mi->module->getDataLayout().getStructLayout(type);
+	uint64_t size = structLayout->getSizeInBytes();
+	uint64_t padding = size;
+	for(unsigned i = 0; i < type->getNumElements(); i++) {
+		padding -= mi->module->getDataLayout().getTypeStoreSize(type->getElementType(i) );
+	}
+
+	std::cerr << "struct " << struc.name << ": " << size << " bytes, aligned to "
+		<< structLayout->getAlignment().value() << ", " << padding << " bytes of padding\n";
+
+	uint64_t end = 0;
+	for(unsigned i = 0; i < type->getNumElements(); i++) {
+		uint64_t offset = structLayout->getElementOffset(i);
+		uint64_t bytes = mi->module->getDataLayout().getTypeStoreSize(type->getElementType(i) );
+		if(offset > end) {
+			std::cerr << "\t" << end << "\thole of " << offset - end << " bytes\n";
+		}
+
+		const auto &member = struc.members[i];
+		uint64_t first = offset / lineSize;
+		uint64_t last = (offset + (bytes > 0 ? bytes - 1 : 0) ) / lineSize;
+		std::cerr << "\t" << offset << '\t' << member.type.string() << ' ' << member.identifier << ", "
+			<< bytes << " bytes, cache line " << first;
+		if(last != first) {
+			std::cerr << " to " << last;
+		}
+		std::cerr << (member.heat == Heat::Hot ? ", hot" : member.heat == Heat::Cold ? ", cold" : "") << '\n';
+		end = offset + bytes;
+	}
+
+	if(size > end) {
+		std::cerr << "\t" << end << "\thole of " << size - end << " bytes\n";
+	}
 }
 
 void LLVMCodeGen::visit(LinkAstNode &node) {
@@ -73,9 +192,20 @@ void LLVMCodeGen::visit(LinkAstNode &node) {
 void LLVMCodeGen::visit(FunctionAstNode &node) {
 	mi->symtable->setActiveFunction(node.signature.name);
 	llvm::Function *func = function = functions[node.signature.name];
+	stackArrays = &node.stackArrays;
 	llvm::BasicBlock *entry = llvm::BasicBlock::Create(ctx->context, "entrypoint", func);
 	ctx->builder.SetInsertPoint(entry);
 
+	//Floating point operations may be reassociated and contracted, NaNs are assumed absent
+	llvm::FastMathFlags fastMath;
+	if(node.isFastMath() ) {
+		fastMath.setAllowReassoc();
+		fastMath.setAllowContract(true);
+		fastMath.setNoNaNs();
+		fastMath.setNoSignedZeros();
+	}
+	ctx->builder.setFastMathFlags(fastMath);
+
 	//Uuum, okay?
 	//TODO: Extend check to see if function is recursive
 	if(node.signature.name == "main") {
@@ -102,6 +232,7 @@ void LLVMCodeGen::visit(FunctionAstNode &node) {
 
 	//Reset bool
 	lastStatementVisitedWasReturn = false;
+	ownedArrays.emplace_back();
 	for(const auto &child : node.children) {
 		if(child) {
 			clear();
@@ -111,8 +242,10 @@ void LLVMCodeGen::visit(FunctionAstNode &node) {
 	
 	//Check to prevent double return/no return at all
 	if(!lastStatementVisitedWasReturn) {
+		freeOwnedArrays(0);
 		ctx->builder.CreateRetVoid();
 	}
+	ownedArrays.pop_back();
 }
 
 void LLVMCodeGen::visit(ExternAstNode &node) {
@@ -134,17 +267,56 @@ void LLVMCodeGen::visit(ExternAstNode &node) {
 
 	llvm::ArrayRef<llvm::Type*> argsRef(callArgs);
 	llvm::FunctionType *funcType = llvm::FunctionType::get(result, argsRef, isVariadic);
-	mi->module->getOrInsertFunction(node.name, funcType);
+	auto callee = mi->module->getOrInsertFunction(node.name, funcType);
+
+	if(auto func = llvm::dyn_cast<llvm::Function>(callee.getCallee() ) ) {
+		std::vector<std::string> attributes;
+		for(auto attribute : node.attributes) {
+			attributes.push_back(attribute->value);
+		}
+		addAttributes(func, attributes);
+	}
 }
 
 void LLVMCodeGen::visit(VariableDeclareAstNode &node) {
-	auto it = ctx->builder.GetInsertBlock();
 	auto type = translateType(node.type);
-	locals->insert(std::make_pair(node.identifier, 
-				new llvm::AllocaInst(type, 0, node.identifier, it) ) );
+	auto alloca = allocateLocal(type, node.identifier);
+	locals->insert(std::make_pair(node.identifier, alloca) );
+
+	llvm::Value *allocator = nullptr;
+	if(node.allocator) {
+		auto oldParams = std::move(callParams);
+		auto oldInsts = std::move(instructions);
+		node.allocator->accept(*this);
+		allocator = ctx->builder.CreatePointerCast(callParams.back(), ctx->builder.getInt8PtrTy() );
+		callParams = std::move(oldParams);
+		instructions = std::move(oldInsts);
+	} else if(node.region && !regions.empty() ) {
+		allocator = regions.back().second;
+		regionArrays.insert(alloca);
+	}
+
+	//Kept next to the header, growing and freeing the array go through it as well
+	if(allocator) {
+		auto slot = allocateLocal(ctx->builder.getInt8PtrTy(), node.identifier + ".allocator");
+		ctx->builder.CreateStore(allocator, slot);
+		allocators[alloca] = slot;
+		currentAllocator = getAllocator(alloca);
+	}
+
 	for(const auto &child : node.children) {
 		child->accept(*this);
 	}
+	currentAllocator = nullptr;
+
+	if(node.children.empty() && (node.owned || allocator) ) {	//Grows from nothing
+		ctx->builder.CreateStore(llvm::Constant::getNullValue(type), alloca);
+	}
+
+	//Registered after the initializer, which must not free the uninitialized header
+	if(node.owned) {
+		ownedArrays.back().push_back(&node);
+	}
 }
 
 void LLVMCodeGen::visit(ReturnAstNode &node) {
@@ -152,10 +324,30 @@ void LLVMCodeGen::visit(ReturnAstNode &node) {
 	for(const auto &child : node.children) {
 		child->accept(*this);
 	}
-	if(callParams.empty() ) {
+
+	llvm::Value *value = callParams.empty() ? nullptr : callParams.back();
+	auto retType = function->getReturnType();
+	if(value && value->getType()->isPointerTy() 
+			&& llvm::cast<llvm::PointerType>(value->getType() )->getElementType() == retType) {
+		value = ctx->builder.CreateLoad(value);	//Aggregates are returned by value
+	} else if(value && value->getType()->isIntegerTy() && retType->isIntegerTy() && value->getType() != retType) {
+		value = convert(value, retType, !isUnsigned(*node.children.front() ) );
+	}
+
+	auto var = node.children.empty() ? nullptr 
+		: dynamic_cast<VariableAstNode*>(node.children.front().get() );
+	if(var && var->moved) {
+		clearArray((*locals)[var->name]);
+	}
+	freeOwnedArrays(0);
+	if(!regions.empty() ) {	//The outermost mark covers every block inside it
+		exitRegion(regions.front().first);
+	}
+
+	if(!value) {
 		ctx->builder.CreateRetVoid();
 	} else {
-		ctx->builder.CreateRet(callParams.back() );
+		ctx->builder.CreateRet(value);
 	} 
 	lastStatementVisitedWasReturn = true;
 }
@@ -168,13 +360,54 @@ void LLVMCodeGen::visit(BranchAstNode &node) {
 	ctx->builder.CreateCondBr(callParams.back(), branch, end);
 
 	ctx->builder.SetInsertPoint(branch);
+	ownedArrays.emplace_back();
 	for(const auto &child : node.children) {
+		clear();
 		child->accept(*this);
 	}
-	ctx->builder.CreateBr(end);
+	freeOwnedArrays(ownedArrays.size() - 1);
+	ownedArrays.pop_back();
+	if(!ctx->builder.GetInsertBlock()->getTerminator() ) {	//Body may have returned
+		ctx->builder.CreateBr(end);
+	}
 	ctx->builder.SetInsertPoint(end);
 }
 
+void LLVMCodeGen::visit(ArenaAstNode &node) {
+	//The region belongs to the thread, the mark records how far it was used before the block
+	auto &builder = ctx->builder;
+	auto mark = builder.CreatePointerCast(allocateLocal(llvm::ArrayType::get(builder.getInt8PtrTy(), 2), "mark"),
+		builder.getInt8PtrTy() );
+	auto enterType = llvm::FunctionType::get(builder.getInt8PtrTy(), {builder.getInt8PtrTy()}, false);
+	auto enter = mi->module->getOrInsertFunction("ghoul_region_enter", enterType);
+	if(auto func = llvm::dyn_cast<llvm::Function>(enter.getCallee() ) ) {
+		func->addFnAttr(llvm::Attribute::NoUnwind);
+	}
+	regions.push_back({mark, builder.CreateCall(enter, {mark})});
+
+	ownedArrays.emplace_back();
+	for(const auto &child : node.children) {
+		clear();
+		child->accept(*this);
+	}
+	freeOwnedArrays(ownedArrays.size() - 1);
+	ownedArrays.pop_back();
+	if(!builder.GetInsertBlock()->getTerminator() ) {	//Body may have returned
+		exitRegion(mark);
+	}
+	regions.pop_back();
+}
+
+void LLVMCodeGen::exitRegion(llvm::Value *mark) {
+	//Only moves the region back to the mark, whatever was allocated after it is reused
+	auto exitType = llvm::FunctionType::get(ctx->builder.getVoidTy(), {ctx->builder.getInt8PtrTy()}, false);
+	auto exit = mi->module->getOrInsertFunction("ghoul_region_exit", exitType);
+	if(auto func = llvm::dyn_cast<llvm::Function>(exit.getCallee() ) ) {
+		func->addFnAttr(llvm::Attribute::NoUnwind);
+	}
+	ctx->builder.CreateCall(exit, {mark});
+}
+
 void LLVMCodeGen::visit(LoopAstNode &node) {
 	llvm::BasicBlock *origin = ctx->builder.GetInsertBlock();
 
@@ -195,20 +428,70 @@ void LLVMCodeGen::visit(LoopAstNode &node) {
 	ctx->builder.CreateCondBr(callParams.back(), branch, end);
 
 	ctx->builder.SetInsertPoint(branch);
+	ownedArrays.emplace_back();
 	for(const auto &child : node.children) {
+		clear();
 		child->accept(*this);
 	}
+	freeOwnedArrays(ownedArrays.size() - 1);
+	ownedArrays.pop_back();
 
-	if(node.loopSuffix) {
-		node.loopSuffix->accept(*this);
-		clear();
-	}
+	if(!ctx->builder.GetInsertBlock()->getTerminator() ) {	//Body may have returned
+		if(node.loopSuffix) {
+			node.loopSuffix->accept(*this);
+			clear();
+		}
 
-	ctx->builder.CreateBr(cond);
+		auto backEdge = ctx->builder.CreateBr(cond);
+		if(!node.hints.empty() ) {
+			backEdge->setMetadata(llvm::LLVMContext::MD_loop, getLoopHints(node) );
+		}
+	}
 	ctx->builder.SetInsertPoint(end);
 }
 
+llvm::MDNode *LLVMCodeGen::getLoopHints(const LoopAstNode &node) {
+	if(Global::config.optLevel == 0) {
+		std::cerr << currentFile << ':' << node.token->row << ':' << node.token->col
+			<< "\nLoop hints are ignored without optimizations\n";
+	}
+
+	auto hint = [this](const std::string &name, llvm::Constant *value) -> llvm::Metadata* {
+		return llvm::MDNode::get(ctx->context, {llvm::MDString::get(ctx->context, name),
+			llvm::ConstantAsMetadata::get(value)});
+	};
+
+	std::vector<llvm::Metadata*> hints = {nullptr};	//The loop id refers to itself
+	for(const auto &h : node.hints) {
+		auto count = ctx->builder.getInt32(h.count);
+		const auto &name = h.token->value;
+		if(name == "vectorize") {
+			hints.push_back(hint("llvm.loop.vectorize.enable", ctx->builder.getTrue() ) );
+			if(h.count > 0) {
+				hints.push_back(hint("llvm.loop.vectorize.width", count) );
+			}
+		} else if(name == "unroll") {
+			hints.push_back(h.count > 0
+				? hint("llvm.loop.unroll.count", count)
+				: llvm::MDNode::get(ctx->context, {llvm::MDString::get(ctx->context, "llvm.loop.unroll.enable")}) );
+		} else if(name == "interleave") {
+			hints.push_back(hint("llvm.loop.interleave.count", count) );
+		} else if(name == "distribute") {
+			hints.push_back(hint("llvm.loop.distribute.enable", ctx->builder.getTrue() ) );
+		}
+	}
+
+	auto id = llvm::MDNode::getDistinct(ctx->context, hints);
+	id->replaceOperandWith(0, id);
+	return id;
+}
+
 void LLVMCodeGen::visit(CallAstNode &node) {
+	if(SymTable::isBuiltin(node.identifier) ) {
+		callBuiltin(node);
+		return;
+	}
+
 	auto oldParams = std::move(callParams);
 	auto oldInsts = std::move(instructions);
 	std::vector<llvm::Type*> callArgs;
@@ -231,6 +514,36 @@ void LLVMCodeGen::visit(CallAstNode &node) {
 		}
 	}
 
+	//Aggregates are visited as their address, the callee takes them by value
+	auto params = func->getFunctionType()->params();
+	for(size_t i = 0; i < callParams.size() && i < params.size(); i++) {
+		auto ptr = llvm::dyn_cast<llvm::PointerType>(callParams[i]->getType() );
+		if(ptr && ptr->getElementType() == params[i]) {
+			callParams[i] = ctx->builder.CreateLoad(callParams[i]);
+		} else if(ptr && sig->parameters[i].arrayOf && sig->parameters[i].isPtr == 0) {	//Slice for array or vice versa
+			callParams[i] = convertView(callParams[i], params[i]);
+		}
+	}
+
+	//Integer arguments take the width of their parameter
+	for(size_t i = 0; i < callParams.size() && i < params.size(); i++) {
+		auto type = callParams[i]->getType();
+		if(type->isIntegerTy() && params[i]->isIntegerTy() && type != params[i]) {
+			callParams[i] = convert(callParams[i], params[i], !isUnsigned(*node.children[i]) );
+		}
+	}
+
+	//C default argument promotion, variadic floats are passed as doubles and narrow integers as ints
+	for(size_t i = params.size(); i < callParams.size(); i++) {
+		auto type = callParams[i]->getType();
+		if(type->isFloatTy() ) {
+			callParams[i] = ctx->builder.CreateFPExt(callParams[i], ctx->builder.getDoubleTy() );
+		} else if(type->isIntegerTy() && type->getIntegerBitWidth() < 32) {
+			bool isSigned = type->getIntegerBitWidth() > 1 && !isUnsigned(*node.children[i]);
+			callParams[i] = convert(callParams[i], ctx->builder.getInt32Ty(), isSigned);
+		}
+	}
+
 	oldParams.push_back(ctx->builder.CreateCall(func, callParams) );
 	callParams = std::move(oldParams);
 	instructions = std::move(oldInsts);
@@ -251,6 +564,7 @@ void LLVMCodeGen::visit(BinExpressionAstNode &node) {
 	node.children.front()->accept(*this);
 	const Type *lhsType = lastType;
 	auto lhsLLVMType = translateType(*lhsType);
+	auto lhsInstruction = instructions.empty() ? nullptr : instructions.back();	//Rhs variables push their own
 
 	node.children.back()->accept(*this);
 	const Type *rhsType = lastType;
@@ -258,10 +572,45 @@ void LLVMCodeGen::visit(BinExpressionAstNode &node) {
 
 	auto &lhs = callParams.front();
 	auto &rhs = callParams.back();
+	bool isFloat = rhs->getType()->isFPOrFPVectorTy();
+
+	//Integers of different widths, the narrower operand is extended to the wider one
+	bool lhsUnsigned = isUnsigned(*node.children.front() );
+	bool rhsUnsigned = isUnsigned(*node.children.back() );
+	bool isUnsignedOp = lhsUnsigned || rhsUnsigned;
+	if(node.type != TokenType::Assign && node.type != TokenType::Push
+			&& lhs->getType()->isIntegerTy() && rhs->getType()->isIntegerTy() ) {
+		auto lhsBits = lhs->getType()->getIntegerBitWidth();
+		auto rhsBits = rhs->getType()->getIntegerBitWidth();
+		if(lhsBits < rhsBits) {
+			lhs = convert(lhs, rhs->getType(), !lhsUnsigned);
+			isUnsignedOp = rhsUnsigned;
+		} else if(lhsBits > rhsBits) {
+			rhs = convert(rhs, lhs->getType(), !rhsUnsigned);
+			isUnsignedOp = lhsUnsigned;
+		}
+	}
+
+	//Scalars combined with vectors apply to every lane
+	if(node.type != TokenType::Assign && node.type != TokenType::Push) {
+		if(auto vector = llvm::dyn_cast<llvm::FixedVectorType>(lhs->getType() ) ) {
+			if(!rhs->getType()->isVectorTy() ) {
+				rhs = ctx->builder.CreateVectorSplat(vector->getNumElements(), rhs);
+			}
+		} else if(auto vector = llvm::dyn_cast<llvm::FixedVectorType>(rhs->getType() ) ) {
+			lhs = ctx->builder.CreateVectorSplat(vector->getNumElements(), lhs);
+		}
+	}
 
 	//TODO: Fix array/matrix assignment
 	if(node.type == TokenType::Assign) {
 		if(shouldAssignArray() ) {
+			auto target = dynamic_cast<VariableAstNode*>(node.children.front().get() );
+			auto owned = target && target->children.empty() ? getOwnedArray(target->name) : nullptr;
+			if(owned) {
+				freeOwnedArray(*owned);	//Replaced by the new array
+			}
+
 			if(lhsIsRAArray) {
 				assignRAArray();
 			} else {
@@ -269,34 +618,65 @@ void LLVMCodeGen::visit(BinExpressionAstNode &node) {
 			}
 		} else if(lhsType->isStruct() && rhsType->isStruct() ) {
 			auto inst = instructions.front();
-			assignStruct(inst, rhs, lhsLLVMType);
+			auto target = dynamic_cast<VariableAstNode*>(node.children.front().get() );
+			auto source = dynamic_cast<VariableAstNode*>(node.children.back().get() );
+			auto owned = target && target->children.empty() ? getOwnedArray(target->name) : nullptr;
+			if(owned && (!source || source->name != target->name) ) {
+				freeOwnedArray(*owned);	//Replaced contents are no longer reachable
+			}
+
+			if(rhs->getType()->isPointerTy() ) {
+				assignStruct(inst, rhs, lhsLLVMType);
+			} else {	//Aggregate returned by value
+				ctx->builder.CreateStore(rhs, inst);
+			}
 		} else {
 			auto inst = instructions.front();
-			ctx->builder.CreateStore(callParams.back(), inst);
+			auto value = callParams.back();
+			auto target = inst->getType()->getPointerElementType();
+			if(value->getType()->isIntegerTy() && target->isIntegerTy() && value->getType() != target) {
+				value = convert(value, target, !rhsUnsigned);
+			}
+			auto store = ctx->builder.CreateStore(value, inst);
+			annotateAccess(store, inst, *lhsType);
+		}
+
+		auto source = dynamic_cast<VariableAstNode*>(node.children.back().get() );
+		if(source && source->moved) {
+			clearArray(rhs);
 		}
 		params.push_back(callParams.back() );
 	} else if(node.type == TokenType::Add) {
-		params.push_back(ctx->builder.CreateAdd(lhs, rhs) );
+		params.push_back(isFloat ? ctx->builder.CreateFAdd(lhs, rhs) : ctx->builder.CreateAdd(lhs, rhs) );
 	} else if(node.type == TokenType::Multiply) {
-		params.push_back(ctx->builder.CreateMul(lhs, rhs) );
+		params.push_back(isFloat ? ctx->builder.CreateFMul(lhs, rhs) : ctx->builder.CreateMul(lhs, rhs) );
 	} else if(node.type == TokenType::Subtract) {
-		params.push_back(ctx->builder.CreateSub(lhs, rhs) );
+		params.push_back(isFloat ? ctx->builder.CreateFSub(lhs, rhs) : ctx->builder.CreateSub(lhs, rhs) );
 	} else if(node.type == TokenType::Divide) {
-		params.push_back(ctx->builder.CreateSDiv(lhs, rhs) );
+		params.push_back(isFloat ? ctx->builder.CreateFDiv(lhs, rhs)
+			: isUnsignedOp ? ctx->builder.CreateUDiv(lhs, rhs) : ctx->builder.CreateSDiv(lhs, rhs) );
 	} else if(node.type == TokenType::Equivalence) {
-		params.push_back(ctx->builder.CreateICmpEQ(lhs, rhs) );
+		params.push_back(isFloat ? ctx->builder.CreateFCmpOEQ(lhs, rhs) : ctx->builder.CreateICmpEQ(lhs, rhs) );
 	} else if(node.type == TokenType::NotEquivalence) {
-		params.push_back(ctx->builder.CreateICmpNE(lhs, rhs) );
+		params.push_back(isFloat ? ctx->builder.CreateFCmpUNE(lhs, rhs) : ctx->builder.CreateICmpNE(lhs, rhs) );
 	} else if(node.type == TokenType::Less) {
-		params.push_back(ctx->builder.CreateICmpSLT(lhs, rhs) );
+		params.push_back(isFloat ? ctx->builder.CreateFCmpOLT(lhs, rhs)
+			: isUnsignedOp ? ctx->builder.CreateICmpULT(lhs, rhs) : ctx->builder.CreateICmpSLT(lhs, rhs) );
 	} else if(node.type == TokenType::LessEquals) {
-		params.push_back(ctx->builder.CreateICmpSLE(lhs, rhs) );
+		params.push_back(isFloat ? ctx->builder.CreateFCmpOLE(lhs, rhs)
+			: isUnsignedOp ? ctx->builder.CreateICmpULE(lhs, rhs) : ctx->builder.CreateICmpSLE(lhs, rhs) );
 	} else if(node.type == TokenType::Greater) {
-		params.push_back(ctx->builder.CreateICmpSGT(lhs, rhs) );
+		params.push_back(isFloat ? ctx->builder.CreateFCmpOGT(lhs, rhs)
+			: isUnsignedOp ? ctx->builder.CreateICmpUGT(lhs, rhs) : ctx->builder.CreateICmpSGT(lhs, rhs) );
 	} else if(node.type == TokenType::GreaterEquals) {
-		params.push_back(ctx->builder.CreateICmpSGE(lhs, rhs) );
+		params.push_back(isFloat ? ctx->builder.CreateFCmpOGE(lhs, rhs)
+			: isUnsignedOp ? ctx->builder.CreateICmpUGE(lhs, rhs) : ctx->builder.CreateICmpSGE(lhs, rhs) );
 	} else if(node.type == TokenType::Push) {
-		pushArray(instructions.back(), rhs);
+		auto element = lhsType->arrayOf ? translateType(*lhsType->arrayOf) : rhs->getType();
+		if(rhs->getType()->isIntegerTy() && element->isIntegerTy() && rhs->getType() != element) {
+			rhs = convert(rhs, element, !rhsUnsigned);
+		}
+		pushArray(lhsInstruction, rhs);
 		params.push_back(rhs);
 	}
 
@@ -340,6 +720,13 @@ void LLVMCodeGen::visit(UnaryExpressionAstNode &node) {
 	} else if(node.type == TokenType::Pop) {
 		popArray(instructions.back() );
 	} else if(node.type == TokenType::Tilde) {
+		auto var = dynamic_cast<VariableAstNode*>(node.children.front().get() );
+		if(var && var->children.empty() && stackArrays->count(var->name) > 0) {
+			return;	//Released along with the stack frame
+		} else if(regionArrays.count(instructions.back() ) > 0) {
+			return;	//Released along with its arena block
+		}
+
 		if(lhsIsRAArray) {
 			freeRAArray(instructions.back() );
 		} else {
@@ -361,9 +748,42 @@ void LLVMCodeGen::visit(CastExpressionAstNode &node) {
 	ctx->builder.Insert(cast);
 	*/
 
-	auto v = ctx->builder.CreateIntCast(callParams.back(), type, true);
+	callParams.back() = convert(callParams.back(), type, !isUnsigned(*node.children.front() ),
+		!node.type.isUnsigned() );
+}
+
+llvm::Value *LLVMCodeGen::convert(llvm::Value *value, llvm::Type *type, bool fromSigned, bool toSigned) {
+	//Scalars are converted to the element type first, then splat
+	auto vector = llvm::dyn_cast<llvm::FixedVectorType>(type);
+	auto target = vector && !value->getType()->isVectorTy() ? vector->getElementType() : type;
+
+	auto from = value->getType()->getScalarType();
+	auto to = target->getScalarType();
+	if(from->isPointerTy() && to->isPointerTy() ) {
+		value = ctx->builder.CreatePointerCast(value, target);
+	} else if(from->isPointerTy() ) {	//Addresses, e.g. to check their alignment
+		value = ctx->builder.CreatePtrToInt(value, target);
+	} else if(to->isPointerTy() ) {
+		value = ctx->builder.CreateIntToPtr(value, target);
+	} else if(from->isFloatingPointTy() && to->isFloatingPointTy() ) {
+		value = ctx->builder.CreateFPCast(value, target);
+	} else if(from->isFloatingPointTy() ) {
+		value = toSigned ? ctx->builder.CreateFPToSI(value, target) : ctx->builder.CreateFPToUI(value, target);
+	} else if(to->isFloatingPointTy() ) {
+		value = fromSigned ? ctx->builder.CreateSIToFP(value, target) : ctx->builder.CreateUIToFP(value, target);
+	} else {
+		value = ctx->builder.CreateIntCast(value, target, fromSigned);
+	}
+
+	if(target != type) {
+		value = ctx->builder.CreateVectorSplat(vector->getNumElements(), value);
+	}
+	return value;
+}
 
-	callParams.back() = v;
+//Array lengths and indicies are 64 bits wide
+llvm::Value *LLVMCodeGen::toLength(llvm::Value *value, const AstNode &expr) {
+	return convert(value, ctx->builder.getInt64Ty(), !isUnsigned(expr) );
 }
 
 void LLVMCodeGen::visit(ArrayAstNode &node) {
@@ -376,7 +796,11 @@ void LLVMCodeGen::visit(ArrayAstNode &node) {
 
 void LLVMCodeGen::visit(IndexAstNode &node) {
 	instructions.back() = loadUntilLastPtr(instructions.back() );
-	if(lhsIsRAArray) {
+	if(lastType->lanes > 0 && lastType->isPtr == 0) {
+		indexVector(node);
+	} else if(node.isSlice) {
+		sliceArray(node);
+	} else if(lhsIsRAArray) {
 		indexRAArray(node);
 	} else {
 		indexArray(node);
@@ -408,7 +832,13 @@ void LLVMCodeGen::visit(MemberVariableAstNode &node) {
 
 	lastType = mi->symtable->typeHasMember(*lastType, node.name);
 	if(node.children.empty() ) {
-		callParams.push_back(ctx->builder.CreateLoad(gep) );
+		if(getAddrsVisited > 0) {
+			callParams.push_back(gep);
+			return;
+		}
+		auto member = ctx->builder.CreateLoad(gep);
+		annotateAccess(member, gep, *lastType);
+		callParams.push_back(member);
 		return;
 	}
 	
@@ -446,9 +876,14 @@ void LLVMCodeGen::visit(StringAstNode &node) {
 }
 
 void LLVMCodeGen::visit(IntAstNode &node) {
-	auto type = llvm::IntegerType::getInt32Ty(ctx->context);
-	callParams.push_back(static_cast<llvm::Value*>(llvm::ConstantInt::get(type, 
-		llvm::APInt(32, node.value) ) ) );
+	bool isLong = node.value < INT_MIN || node.value > INT_MAX;
+	auto type = isLong ? ctx->builder.getInt64Ty() : ctx->builder.getInt32Ty();
+	callParams.push_back(llvm::ConstantInt::get(type, node.value, true) );
+}
+
+void LLVMCodeGen::visit(FloatAstNode &node) {
+	auto type = node.isDouble ? ctx->builder.getDoubleTy() : ctx->builder.getFloatTy();
+	callParams.push_back(llvm::ConstantFP::get(type, node.value) );
 }
 
 void LLVMCodeGen::visit(BoolAstNode &node) {
@@ -457,6 +892,14 @@ void LLVMCodeGen::visit(BoolAstNode &node) {
 		llvm::APInt(1, node.value) ) ) );
 }
 
+unsigned LLVMCodeGen::getBoundsChecksInserted() const {
+	return boundsChecksInserted;
+}
+
+unsigned LLVMCodeGen::getBoundsChecksElided() const {
+	return boundsChecksElided;
+}
+
 llvm::Type *LLVMCodeGen::translateType(const Type &ghoulType) {
 	std::string name = ghoulType.name;
 	return translateType(ghoulType, name);
@@ -468,12 +911,20 @@ llvm::Type *LLVMCodeGen::translateType(const Type &ghoulType, std::string &name)
 		type = ctx->builder.getInt8Ty();
 	} else if(ghoulType.name == "bool") {
 		type = ctx->builder.getInt1Ty();
-	} else if(ghoulType.name == "int") {
+	} else if(ghoulType.name == "int" || ghoulType.name == "u32") {
 		type = ctx->builder.getInt32Ty();
+	} else if(ghoulType.name == "i64" || ghoulType.name == "u64") {
+		type = ctx->builder.getInt64Ty();
+	} else if(ghoulType.name == "i16") {
+		type = ctx->builder.getInt16Ty();
+	} else if(ghoulType.name == "u8") {
+		type = ctx->builder.getInt8Ty();
 	} else if(ghoulType.name == "void") {
 		type = ctx->builder.getVoidTy();
 	} else if(ghoulType.name == "float") {
 		type = ctx->builder.getFloatTy();
+	} else if(ghoulType.name == "double") {
+		type = ctx->builder.getDoubleTy();
 	} else if(ghoulType.name == "...") {
 		return nullptr;	
 	} else if(!ghoulType.arrayOf) {
@@ -500,13 +951,21 @@ llvm::Type *LLVMCodeGen::translateType(const Type &ghoulType, std::string &name)
 		//ghoulType.arrayOf->isPtr = 0;	//Get underlying type if ptr
 		type = translateType(*ghoulType.arrayOf, name);
 		//ghoulType.arrayOf->isPtr = isPtr;
-		if(ghoulType.realignedArray) {
-			type = getRAArrayType(type, ghoulType);
+		if(ghoulType.realignedArray) {	//Slices keep the header layout, their capacity is zero
+			Type whole = ghoulType;
+			whole.isSlice = false;
+			type = getRAArrayType(type, whole);
+		} else if(ghoulType.isSlice) {
+			type = getSliceType(type, ghoulType);
 		} else {
 			type = getArrayType(type, ghoulType);
 		}
 	}
 
+	if(ghoulType.lanes > 0) {
+		type = llvm::FixedVectorType::get(type, ghoulType.lanes);
+	}
+
 	for(int i = 0; i < ghoulType.isPtr; i++) {
 		type = type->getPointerTo();
 	}
@@ -514,19 +973,27 @@ llvm::Type *LLVMCodeGen::translateType(const Type &ghoulType, std::string &name)
 	return type;
 }
 
-void LLVMCodeGen::prepareToplevelNode(ToplevelAstNode &node) {
+void LLVMCodeGen::prepareToplevelNode(ToplevelAstNode &node, bool imported) {
 	buildStructDefinitions(node.structs);
 	for(auto toplevel : node.toplevels) {
-		prepareToplevelNode(*toplevel);
+		prepareToplevelNode(*toplevel, true);
+	}
+	//Realigned arrays in signatures need the struct members
+	for(auto s : node.structs) {
+		visit(*s);
 	}
 	for(auto ext : node.externs) {
 		visit(*ext);
 	}
-	buildFunctionDefinitions(node.functions);
+	buildFunctionDefinitions(node.functions, imported);
 }
 
-void LLVMCodeGen::buildFunctionDefinitions(const std::vector<FunctionAstNode*> &funcs) {
+void LLVMCodeGen::buildFunctionDefinitions(const std::vector<FunctionAstNode*> &funcs, bool imported) {
 	for(auto f : funcs) {
+		if(functions.count(f->signature.name) > 0) {	//Imported more than once
+			continue;
+		}
+
 		std::vector<llvm::Type*> types;
 		for(auto p : f->signature.parameters) {
 			types.push_back(translateType(p) );
@@ -543,6 +1010,20 @@ void LLVMCodeGen::buildFunctionDefinitions(const std::vector<FunctionAstNode*> &
 		}
 
 		func->setCallingConv(llvm::CallingConv::C);
+		addAttributes(func, f->attributes);
+		if(f->isInline) {
+			func->addFnAttr(llvm::Attribute::AlwaysInline);
+		}
+		if(f->isFastMath() ) {
+			func->addFnAttr("unsafe-fp-math", "true");
+			func->addFnAttr("no-nans-fp-math", "true");
+			func->addFnAttr("no-signed-zeros-fp-math", "true");
+		}
+
+		//Library bodies may be inlined and dropped, or merged with another copy
+		if(imported && f->signature.name != "main") {
+			func->setLinkage(llvm::Function::LinkOnceODRLinkage);
+		}
 
 		functions.insert(std::make_pair(f->signature.name, func) );
 
@@ -552,57 +1033,70 @@ void LLVMCodeGen::buildFunctionDefinitions(const std::vector<FunctionAstNode*> &
 	}
 }
 
+void LLVMCodeGen::addAttributes(llvm::Function *func, const std::vector<std::string> &attributes) {
+	for(const auto &name : attributes) {
+		auto kind = llvm::Attribute::getAttrKindFromName(name);
+		if(kind == llvm::Attribute::NoAlias) {	//Describes the returned pointer
+			func->addAttribute(llvm::AttributeList::ReturnIndex, kind);
+		} else {
+			func->addFnAttr(kind);
+		}
+	}
+}
+
 void LLVMCodeGen::buildStructDefinitions(const std::vector<StructAstNode*> &structs) {
 	for(auto ptr : structs) {
 		llvm::StructType *newStruct = llvm::StructType::create(ctx->context, ptr->name);
 		structTypes.insert({ptr->name, newStruct});
+		structNodes.insert({ptr->name, ptr});
 	}
 }
 
-//TODO: Remove all calls to this
-llvm::Value *LLVMCodeGen::allocateHeap(Type type, llvm::Value *length) {
-	static llvm::Type *result = ctx->builder.getInt8Ty()->getPointerTo();
-	static llvm::Type *argsRef = ctx->builder.getInt32Ty();
-	static llvm::FunctionType *funcType = llvm::FunctionType::get(result, {argsRef}, false);
-	const static llvm::FunctionCallee func = mi->module->getOrInsertFunction("malloc", funcType);
-
-	auto memLength = ctx->builder.CreateMul(length, llvm::ConstantInt::get(ctx->builder.getInt32Ty(),
-		llvm::APInt(32, type.size() ) ) );
-	auto heapAlloc = ctx->builder.CreateCall(func, {memLength});
-	auto cast = ctx->builder.CreatePointerCast(heapAlloc, translateType(type)->getPointerTo() );
-
-	return cast;
-}
-
-llvm::Value *LLVMCodeGen::allocateHeap(llvm::Type *type, llvm::Value *length) {
+llvm::Value *LLVMCodeGen::allocateHeap(llvm::Type *type, llvm::Value *length, llvm::Value *allocator) {
 	static llvm::Type *result = ctx->builder.getInt8Ty()->getPointerTo();
-	static llvm::Type *argsRef = ctx->builder.getInt32Ty();
-	static llvm::FunctionType *funcType = llvm::FunctionType::get(result, {argsRef}, false);
-	const static llvm::FunctionCallee func = mi->module->getOrInsertFunction("malloc", funcType);
+	static llvm::Type *argsRef = ctx->builder.getInt64Ty();
+	static llvm::FunctionType *funcType = llvm::FunctionType::get(result, {argsRef, argsRef}, false);
+	const static llvm::FunctionCallee func = mi->module->getOrInsertFunction("aligned_alloc", funcType);
+
+	auto align = Global::config.arrayAlignment;
+	auto elementSize = ctx->builder.getInt64(mi->module->getDataLayout().getTypeAllocSize(type) );
+	llvm::Value *heapAlloc = nullptr;
+	if(allocator) {	//Handed on to the allocator by the runtime
+		auto allocType = llvm::FunctionType::get(result, {argsRef, argsRef, argsRef, result}, false);
+		auto alloc = mi->module->getOrInsertFunction("ghoul_array_alloc", allocType);
+		heapAlloc = ctx->builder.CreateCall(alloc, {length, elementSize, getArrayAlignment(), allocator});
+	} else {	//aligned_alloc takes whole multiples of the alignment
+		auto memLength = ctx->builder.CreateMul(length, elementSize);
+		memLength = ctx->builder.CreateAnd(ctx->builder.CreateAdd(memLength, ctx->builder.getInt64(align - 1) ),
+			ctx->builder.getInt64(~static_cast<uint64_t>(align - 1) ) );
+		heapAlloc = ctx->builder.CreateCall(func, {getArrayAlignment(), memLength});
+	}
 
-	auto memLength = ctx->builder.CreateMul(length, llvm::ConstantInt::get(ctx->builder.getInt32Ty(),
-		llvm::APInt(32, mi->module->getDataLayout().getTypeAllocSize(type) ) ) );
-	auto heapAlloc = ctx->builder.CreateCall(func, {memLength});
+	//Known to the vectorizer, which may then use aligned loads on fresh arrays
+	ctx->builder.CreateAlignmentAssumption(mi->module->getDataLayout(), heapAlloc, align);
 	auto cast = ctx->builder.CreatePointerCast(heapAlloc, type->getPointerTo() );
 
 	return cast;
 }
 
-llvm::Value *LLVMCodeGen::reallocateHeap(Type type, llvm::Value *addr, llvm::Value *length) {
-	static llvm::Type *result = ctx->builder.getVoidTy()->getPointerTo();
-	static llvm::Type *ptrArg = ctx->builder.getVoidTy()->getPointerTo();
-	static llvm::Type *countArg = ctx->builder.getInt32Ty();
-	static llvm::FunctionType *funcType = llvm::FunctionType::get(result, {ptrArg, countArg}, false);
-	const static llvm::FunctionCallee func = mi->module->getOrInsertFunction("realloc", funcType);
+llvm::AllocaInst *LLVMCodeGen::allocateLocal(llvm::Type *type, const std::string &name) {
+	//Allocas in the entry block are only reserved once per call, even if created inside a loop,
+	//and may be promoted to registers
+	auto &entry = function->getEntryBlock();
+	llvm::IRBuilder<> entryBuilder(&entry, entry.begin() );
+	return entryBuilder.CreateAlloca(type, nullptr, name);
+}
 
-	type.isPtr--;
-	auto memLength = ctx->builder.CreateMul(length, llvm::ConstantInt::get(ctx->builder.getInt32Ty(),
-		llvm::APInt(32, type.size() ) ) );
-	type.isPtr++;
-	auto heapAlloc = ctx->builder.CreateCall(func, {addr, memLength});
-	auto cast = ctx->builder.CreatePointerCast(heapAlloc, translateType(type) );
+llvm::Value *LLVMCodeGen::allocateStack(llvm::Type *type, unsigned length) {
+	auto alloca = allocateLocal(llvm::ArrayType::get(type, length) );
+	if(alloca->getAlign().value() < Global::config.arrayAlignment) {	//Same as heap storage
+		alloca->setAlignment(llvm::Align(Global::config.arrayAlignment) );
+	}
 
-	return cast;
+	llvm::Value *llvmZero = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), llvm::APInt(32, 0) );
+	auto gep = llvm::GetElementPtrInst::CreateInBounds(alloca, {llvmZero, llvmZero} );
+	ctx->builder.Insert(gep);
+	return gep;
 }
 
 llvm::Type *LLVMCodeGen::getArrayType(llvm::Type *type, const Type &ghoulType) {
@@ -611,7 +1105,7 @@ llvm::Type *LLVMCodeGen::getArrayType(llvm::Type *type, const Type &ghoulType) {
 	llvm::StructType *arrayType;
 	if(it == structTypes.end() ) {
 		arrayType = llvm::StructType::create(ctx->context, name);
-		arrayType->setBody({type->getPointerTo(), ctx->builder.getInt32Ty(), ctx->builder.getInt32Ty()});
+		arrayType->setBody({type->getPointerTo(), ctx->builder.getInt64Ty(), ctx->builder.getInt64Ty()});
 		structTypes.insert({name, arrayType});
 	} else {
 		arrayType = it->second;
@@ -620,36 +1114,135 @@ llvm::Type *LLVMCodeGen::getArrayType(llvm::Type *type, const Type &ghoulType) {
 	return arrayType;
 }
 
+llvm::Type *LLVMCodeGen::getSliceType(llvm::Type *type, const Type &ghoulType) {
+	std::string name = ghoulType.string();
+	auto it = structTypes.find(name);
+	llvm::StructType *sliceType;
+	if(it == structTypes.end() ) {	//Data and length in the same place as for arrays
+		sliceType = llvm::StructType::create(ctx->context, name);
+		sliceType->setBody({type->getPointerTo(), ctx->builder.getInt64Ty()});
+		structTypes.insert({name, sliceType});
+	} else {
+		sliceType = it->second;
+	}
+
+	return sliceType;
+}
+
+void LLVMCodeGen::sliceArray(IndexAstNode &node) {
+	llvm::Instruction *array = instructions.back();
+	auto prevType = lastType;
+	auto oldVals = std::move(callParams);
+	auto oldInsts = std::move(instructions);
+	auto oldAddrs = getAddrsVisited;
+	auto oldLhs = lhsIsRAArray;
+	getAddrsVisited = 0;	//Bounds are values even when the slice's address is taken
+	node.index->accept(*this);
+	auto lo = toLength(callParams.back(), *node.index);
+	llvm::Value *hi = nullptr;
+	if(node.end) {
+		node.end->accept(*this);
+		hi = toLength(callParams.back(), *node.end);
+	}
+	getAddrsVisited = oldAddrs;
+	lhsIsRAArray = oldLhs;
+	lastType = prevType;
+	callParams = std::move(oldVals);
+	instructions = std::move(oldInsts);
+
+	auto length = lhsIsRAArray ? getRAArrayLength(array) : getArrayLength(array);
+	hi = hi ? hi : length;
+	if(Global::config.boundsChecks) {
+		checkSliceBounds(lo, hi, length, node.token);
+	}
+
+	Type sliceType = *prevType;
+	sliceType.isPtr = 0;
+	sliceType.isSlice = true;
+	auto slice = allocateLocal(translateType(sliceType) );
+	auto count = ctx->builder.CreateSub(hi, lo);
+	if(lhsIsRAArray) {	//Every column is offset alike
+		auto columns = slice->getAllocatedType()->getStructNumElements();
+		ctx->builder.CreateStore(count, getArrayField(slice, 0) );
+		ctx->builder.CreateStore(ctx->builder.getInt64(0), getArrayField(slice, 1) );
+		for(unsigned i = 2; i < columns; i++) {
+			auto column = ctx->builder.CreateLoad(getArrayField(array, i) );
+			ctx->builder.CreateStore(ctx->builder.CreateInBoundsGEP(column, lo), getArrayField(slice, i) );
+		}
+	} else {
+		auto data = ctx->builder.CreateInBoundsGEP(getArrayData(array), lo);
+		ctx->builder.CreateStore(data, getArrayField(slice, 0) );
+		ctx->builder.CreateStore(count, getArrayField(slice, 1) );
+	}
+
+	//Used as a whole, like the array it views
+	instructions.back() = slice;
+	callParams.push_back(slice);
+}
+
+llvm::Value *LLVMCodeGen::convertView(llvm::Value *view, llvm::Type *type) {
+	//Slices become arrays without capacity, arrays become slices of all their elements
+	llvm::Value *result = llvm::UndefValue::get(type);
+	auto data = ctx->builder.CreateLoad(getArrayField(view, 0) );
+	auto length = ctx->builder.CreateLoad(getArrayField(view, 1) );
+	result = ctx->builder.CreateInsertValue(result, data, 0);
+	result = ctx->builder.CreateInsertValue(result, length, 1);
+	if(type->getStructNumElements() > 2) {
+		result = ctx->builder.CreateInsertValue(result, ctx->builder.getInt64(0), 2);
+	}
+	return result;
+}
+
 void LLVMCodeGen::createArray(ArrayAstNode &node) {
 	llvm::Type *arrayType = translateType(node.type);
 	if(!node.length) {	//Only declared array type, null it
 		llvm::Type *underlyingType = arrayType->getStructElementType(0)->getPointerTo();	//Hardcoded
 		callParams.push_back(llvm::ConstantPointerNull::get(
 			llvm::cast<llvm::PointerType>(underlyingType) ) );
-		arrayLength = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), 0);
+		arrayLength = ctx->builder.getInt64(0);
 		return;
 	} 
 
 	node.length->accept(*this);
-	arrayLength = callParams.back();
+	arrayLength = toLength(callParams.back(), *node.length);
 	callParams.pop_back();
 
-	llvm::Value *heapAlloc = allocateHeap(arrayType, arrayLength);
+	llvm::Type *elementType = arrayType->getStructElementType(0)->getPointerElementType();
+	if(node.stackLength > 0) {
+		callParams.push_back(allocateStack(elementType, node.stackLength) );
+		return;
+	}
+
+	llvm::Value *heapAlloc = allocateHeap(elementType, arrayLength, currentAllocator);
 	callParams.push_back(heapAlloc);
 }
 
 void LLVMCodeGen::indexArray(IndexAstNode &node) {
 	llvm::Value *llvmZero = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), llvm::APInt(32, 0) );
-	llvm::Instruction *addrFromStruct = llvm::GetElementPtrInst::CreateInBounds(instructions.back(), 
+	llvm::Instruction *array = instructions.back();
+	llvm::Instruction *addrFromStruct = llvm::GetElementPtrInst::CreateInBounds(array, 
 			{llvmZero, llvmZero} );	//First dereferences, second specifies member
 	ctx->builder.Insert(addrFromStruct);
 	auto load = ctx->builder.CreateLoad(addrFromStruct);
+	annotateDataPointer(load);
 
 	auto prevType = lastType;
 	auto oldVals = std::move(callParams);
 	auto oldInsts = std::move(instructions);
+	auto oldAddrs = getAddrsVisited;
+	getAddrsVisited = 0;	//Index is a value even when the element's address is taken
 	node.index->accept(*this);
+	getAddrsVisited = oldAddrs;
 	lastType = prevType;
+	callParams.back() = toLength(callParams.back(), *node.index);
+
+	if(Global::config.boundsChecks) {
+		if(node.provenInBounds) {
+			boundsChecksElided++;
+		} else {
+			checkBounds(callParams.back(), getArrayLength(array), node.token);
+		}
+	}
 
 	llvm::Instruction *gep = llvm::GetElementPtrInst::CreateInBounds(load, 
 			{callParams.back()} );
@@ -658,19 +1251,17 @@ void LLVMCodeGen::indexArray(IndexAstNode &node) {
 	callParams = std::move(oldVals);
 	instructions = std::move(oldInsts);
 
-	if(instructions.size() == 1) {	//Edge case
-		instructions.back() = gep;
-	} else {
-		*(instructions.end() - 2) = gep;
-	}
+	instructions.back() = gep;
 
 	lastType = lastType->arrayOf.get();
 
 	if(node.children.empty() ) {
-		if(lastType->isStruct() ) {
+		if(getAddrsVisited > 0 || lastType->isStruct() ) {
 			callParams.push_back(gep);
 		} else {
-			callParams.push_back(ctx->builder.CreateLoad(gep) );
+			auto element = ctx->builder.CreateLoad(gep);
+			annotateAccess(element, gep, *lastType);
+			callParams.push_back(element);
 		}
 		return;
 	}
@@ -716,7 +1307,9 @@ llvm::Value *LLVMCodeGen::getArrayLength(llvm::Instruction *array) {
 	llvm::Value *llvmOne = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), llvm::APInt(32, 1) );
 	auto size = llvm::GetElementPtrInst::CreateInBounds(array, {llvmZero, llvmOne} );
 	ctx->builder.Insert(size);
-	return ctx->builder.CreateLoad(size);
+	auto length = ctx->builder.CreateLoad(size);
+	length->setMetadata(llvm::LLVMContext::MD_tbaa, getTBAATag("array length") );
+	return length;
 }
 
 void LLVMCodeGen::setArrayLength(llvm::Instruction *array, llvm::Value *length) {
@@ -724,144 +1317,438 @@ void LLVMCodeGen::setArrayLength(llvm::Instruction *array, llvm::Value *length)
 	llvm::Value *llvmOne = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), llvm::APInt(32, 1) );
 	auto size = llvm::GetElementPtrInst::CreateInBounds(array, {llvmZero, llvmOne} );
 	ctx->builder.Insert(size);
-	ctx->builder.CreateStore(length, size);
+	auto store = ctx->builder.CreateStore(length, size);
+	store->setMetadata(llvm::LLVMContext::MD_tbaa, getTBAATag("array length") );
 }
 
 void LLVMCodeGen::popArray(llvm::Instruction *array) {
-	auto llvmOne = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), llvm::APInt(32, 1) );
+	auto llvmOne = ctx->builder.getInt64(1);
+	if(isRAArray(array) ) {
+		auto size = getArrayField(array, 0);
+		auto store = ctx->builder.CreateStore(ctx->builder.CreateSub(getRAArrayLength(array), llvmOne), size);
+		store->setMetadata(llvm::LLVMContext::MD_tbaa, getTBAATag("array length") );
+		return;
+	}
+
 	auto length = getArrayLength(array);
 	auto newLength = ctx->builder.CreateSub(length, llvmOne);
 	setArrayLength(array, newLength);
 }
 
-void LLVMCodeGen::pushArray(llvm::Instruction *array, llvm::Value *value) {
+llvm::Instruction *LLVMCodeGen::getArrayField(llvm::Value *array, unsigned field) {
 	llvm::Value *llvmZero = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), llvm::APInt(32, 0) );
-	llvm::Value *llvmOne = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), llvm::APInt(32, 1) );
-	llvm::Value *llvmTwo = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), llvm::APInt(32, 2) );
+	llvm::Value *llvmField = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), llvm::APInt(32, field) );
+	auto gep = llvm::GetElementPtrInst::CreateInBounds(array, {llvmZero, llvmField} );
+	ctx->builder.Insert(gep);
+	return gep;
+}
 
-	auto addr = llvm::GetElementPtrInst::CreateInBounds(array, {llvmZero, llvmZero} );
-	auto size = llvm::GetElementPtrInst::CreateInBounds(array, {llvmZero, llvmOne} );
-	auto capacity = llvm::GetElementPtrInst::CreateInBounds(array, {llvmZero, llvmTwo} );
+llvm::Value *LLVMCodeGen::getArrayData(llvm::Instruction *array) {
+	//May still be null for arrays that never had storage
+	auto data = ctx->builder.CreateLoad(getArrayField(array, 0) );
+	data->setMetadata(llvm::LLVMContext::MD_tbaa, getTBAATag("array data") );
+	return data;
+}
 
-	ctx->builder.Insert(addr);
-	ctx->builder.Insert(size);
-	ctx->builder.Insert(capacity);
+llvm::Value *LLVMCodeGen::getElementSize(llvm::Instruction *array) {
+	auto element = array->getType()->getPointerElementType()->getStructElementType(0)->getPointerElementType();
+	return ctx->builder.getInt64(mi->module->getDataLayout().getTypeAllocSize(element) );
+}
 
-	llvm::BasicBlock *origin = ctx->builder.GetInsertBlock();
+llvm::Value *LLVMCodeGen::getArrayAlignment() {
+	return ctx->builder.getInt64(Global::config.arrayAlignment);
+}
+
+llvm::Value *LLVMCodeGen::getAllocator(llvm::Value *array) {
+	//Null for the C heap, arrays reached through pointers or parameters always use it
+	auto it = allocators.find(array);
+	if(it == allocators.end() ) {
+		return llvm::ConstantPointerNull::get(ctx->builder.getInt8PtrTy() );
+	}
+	return ctx->builder.CreateLoad(it->second);
+}
+
+void LLVMCodeGen::callRuntime(const std::string &name, llvm::Instruction *array, std::vector<llvm::Value*> args) {
+	//Out of line helpers from libghoulrt, taking the array header first
+	auto header = ctx->builder.getInt8Ty()->getPointerTo();
+	std::vector<llvm::Type*> argTypes = {header};
+	for(auto arg : args) {
+		argTypes.push_back(arg->getType() );
+	}
 
-	llvm::BasicBlock *nullCheckBr = llvm::BasicBlock::Create(ctx->context, "", function);
-	llvm::BasicBlock *capCheckBr = llvm::BasicBlock::Create(ctx->context, "", function);
-	llvm::BasicBlock *capCheckBrImpl = llvm::BasicBlock::Create(ctx->context, "", function);
-	llvm::BasicBlock *reallocBr = llvm::BasicBlock::Create(ctx->context, "", function);
+	auto funcType = llvm::FunctionType::get(ctx->builder.getVoidTy(), argTypes, false);
+	auto callee = mi->module->getOrInsertFunction(name, funcType);
+	if(auto func = llvm::dyn_cast<llvm::Function>(callee.getCallee() ) ) {
+		func->addFnAttr(llvm::Attribute::Cold);
+		func->addFnAttr(llvm::Attribute::NoUnwind);
+	}
+
+	args.insert(args.begin(), ctx->builder.CreatePointerCast(array, header) );
+	ctx->builder.CreateCall(callee, args);
+}
+
+void LLVMCodeGen::reserveArray(llvm::Instruction *array, llvm::Value *required, bool grow) {
+	auto &builder = ctx->builder;
+	bool isRealigned = isRAArray(array);
+	auto capacity = builder.CreateLoad(getArrayField(array, isRealigned ? 1 : 2) );
+
+	llvm::BasicBlock *growBr = llvm::BasicBlock::Create(ctx->context, "", function);
 	llvm::BasicBlock *end = llvm::BasicBlock::Create(ctx->context, "", function);
+	auto weights = grow ? llvm::MDBuilder(ctx->context).createBranchWeights(1, 2000) : nullptr;
+	builder.CreateCondBr(builder.CreateICmpUGT(required, capacity), growBr, end, weights);
+
+	builder.SetInsertPoint(growBr);
+	auto growth = builder.getInt32(static_cast<uint32_t>(Global::config.growth) );
+	if(isRealigned) {	//Every column moves to a new block
+		auto type = array->getType()->getPointerElementType();
+		auto count = builder.getInt32(type->getStructNumElements() - 2);
+		if(grow) {
+			callRuntime("ghoul_columns_grow", array, {required, count, getColumnSizes(type), growth,
+				getArrayAlignment(), getAllocator(array)});
+		} else {
+			callRuntime("ghoul_columns_reserve", array, {required, count, getColumnSizes(type),
+				getArrayAlignment(), getAllocator(array)});
+		}
+	} else if(grow) {
+		callRuntime("ghoul_array_grow", array, {required, getElementSize(array), growth, getArrayAlignment(),
+			getAllocator(array)});
+	} else {
+		callRuntime("ghoul_array_reserve", array, {required, getElementSize(array), getArrayAlignment(),
+			getAllocator(array)});
+	}
+	builder.CreateBr(end);
 
-	auto loadedAddr = ctx->builder.CreateLoad(addr);
+	builder.SetInsertPoint(end);
+}
 
-	//Nullcheck
-	auto nullCheck = ctx->builder.CreateICmpEQ(loadedAddr,
-		llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(loadedAddr->getType() ) ) );
-	ctx->builder.CreateCondBr(nullCheck, nullCheckBr, capCheckBr);	// if addr is null
+void LLVMCodeGen::pushArray(llvm::Instruction *array, llvm::Value *value) {
+	//Only a store and an increment inline, growing is left to the runtime
+	if(isRAArray(array) ) {	//Scattered into every column
+		auto type = array->getType()->getPointerElementType();
+		auto length = getRAArrayLength(array);
+		auto newLength = ctx->builder.CreateAdd(length, ctx->builder.getInt64(1) );
+		reserveArray(array, newLength, true);
+
+		for(unsigned i = 2; i < type->getStructNumElements(); i++) {
+			auto member = value->getType()->isPointerTy()
+				? ctx->builder.CreateLoad(getArrayField(value, i - 2) )
+				: ctx->builder.CreateExtractValue(value, {i - 2});
+			auto column = ctx->builder.CreateLoad(getArrayField(array, i) );
+			ctx->builder.CreateStore(member, ctx->builder.CreateInBoundsGEP(column, length) );
+		}
 
-	ctx->builder.SetInsertPoint(nullCheckBr);
+		auto store = ctx->builder.CreateStore(newLength, getArrayField(array, 0) );
+		store->setMetadata(llvm::LLVMContext::MD_tbaa, getTBAATag("array length") );
+		return;
+	}
 
-	auto dummyType = *lastType->arrayOf;
-	dummyType.isPtr++;
-	llvm::Value *mallocCall = allocateHeap(dummyType, llvmOne);
+	auto length = getArrayLength(array);
+	auto newLength = ctx->builder.CreateAdd(length, ctx->builder.getInt64(1) );
+	reserveArray(array, newLength, true);
 
-	ctx->builder.CreateStore(mallocCall, addr);
-	ctx->builder.CreateStore(llvmOne, size);
-	ctx->builder.CreateStore(llvmOne, capacity);
-	auto index = llvm::GetElementPtrInst::CreateInBounds(addr, {llvmZero} );	//Assign
+	auto index = llvm::GetElementPtrInst::CreateInBounds(getArrayData(array), {length} );	//Assign
 	ctx->builder.Insert(index);
-	auto loadedIndex = ctx->builder.CreateLoad(index);
-	ctx->builder.CreateStore(value, loadedIndex);
+	auto element = index->getType()->getPointerElementType();
+	if(element->isStructTy() && value->getType()->isPointerTy() ) {	//Structs are visited as their address
+		assignStruct(index, value, element);
+	} else {
+		ctx->builder.CreateStore(value, index);
+	}
+	setArrayLength(array, newLength);
+}
 
-	ctx->builder.CreateBr(end);
+void LLVMCodeGen::appendArray(llvm::Instruction *array, llvm::Instruction *source) {
+	callRuntime("ghoul_array_append", array, {ctx->builder.CreatePointerCast(source, ctx->builder.getInt8PtrTy() ),
+		getElementSize(array), ctx->builder.getInt32(static_cast<uint32_t>(Global::config.growth) ),
+		getArrayAlignment(), getAllocator(array)});
+}
 
-	//Capacitycheck
-	ctx->builder.SetInsertPoint(capCheckBr);
+void LLVMCodeGen::resizeArray(llvm::Instruction *array, llvm::Value *length) {
+	auto element = array->getType()->getPointerElementType()->getStructElementType(0)->getPointerElementType();
+	auto oldLength = getArrayLength(array);
+	reserveArray(array, length, false);
+
+	//New elements start out zeroed
+	auto isLonger = ctx->builder.CreateICmpUGT(length, oldLength);
+	auto added = ctx->builder.CreateSelect(isLonger, ctx->builder.CreateSub(length, oldLength), ctx->builder.getInt64(0) );
+	auto dest = llvm::GetElementPtrInst::CreateInBounds(getArrayData(array), {oldLength} );
+	ctx->builder.Insert(dest);
+	auto bytes = ctx->builder.CreateMul(added, getElementSize(array) );
+	ctx->builder.CreateMemSet(dest, ctx->builder.getInt8(0), bytes,
+		llvm::MaybeAlign(mi->module->getDataLayout().getABITypeAlignment(element) ) );
+	setArrayLength(array, length);
+}
 
-	auto loadedCap = ctx->builder.CreateLoad(capacity);
-	auto loadedSize = ctx->builder.CreateLoad(size);
-	auto newSize = ctx->builder.CreateAdd(loadedSize, llvmOne);
-	auto capCheck = ctx->builder.CreateICmpSLE(newSize, loadedCap);
+void LLVMCodeGen::shrinkArray(llvm::Instruction *array) {
+	callRuntime("ghoul_array_shrink", array, {getElementSize(array), getArrayAlignment(), getAllocator(array)});
+}
 
-	ctx->builder.CreateCondBr(capCheck, capCheckBrImpl, reallocBr);	// if new size <= capacity
-	ctx->builder.SetInsertPoint(capCheckBrImpl);
-	loadedSize = ctx->builder.CreateLoad(size);
-	index = llvm::GetElementPtrInst::CreateInBounds(addr, {loadedSize} );	//Assign
-	ctx->builder.Insert(index);
-	loadedIndex = ctx->builder.CreateLoad(index);
-	ctx->builder.CreateStore(value, loadedIndex);
-	ctx->builder.CreateStore(newSize, size);
-
-	ctx->builder.CreateBr(end);
-
-	//Realloc
-	ctx->builder.SetInsertPoint(reallocBr);
-
-	loadedCap = ctx->builder.CreateLoad(capacity);
-	auto newCap = ctx->builder.CreateShl(loadedCap, llvmOne);
-	dummyType.isPtr--;
-	auto typeSize = dummyType.size();
-	dummyType.isPtr++;
-	auto numBytes = ctx->builder.CreateMul(
-		llvm::ConstantInt::get(ctx->builder.getInt32Ty(), typeSize), loadedCap);
-	ctx->builder.CreateStore(newCap, capacity);
-	auto newMem = reallocateHeap(dummyType, loadedAddr, newCap);
-	ctx->builder.CreateStore(newMem, addr);
-	loadedSize = ctx->builder.CreateLoad(size);								//Resize
-	newSize = ctx->builder.CreateAdd(loadedSize, llvmOne);
-	index = llvm::GetElementPtrInst::CreateInBounds(newMem, {loadedSize});	//Assign
-	ctx->builder.Insert(index);
-	ctx->builder.CreateStore(value, index);
-	ctx->builder.CreateStore(newSize, size);
+void LLVMCodeGen::checkBounds(llvm::Value *index, llvm::Value *length, Token *token) {
+	//Unsigned comparison also catches negative indicies
+	auto inBounds = ctx->builder.CreateICmpULT(index, length);
+	trapUnless(inBounds, "index %lld is out of bounds for array of length %lld\n", {index, length}, token);
+}
 
-	ctx->builder.CreateBr(end);
+void LLVMCodeGen::checkSliceBounds(llvm::Value *lo, llvm::Value *hi, llvm::Value *length, Token *token) {
+	auto inBounds = ctx->builder.CreateAnd(ctx->builder.CreateICmpULE(lo, hi), ctx->builder.CreateICmpULE(hi, length) );
+	trapUnless(inBounds, "slice %lld:%lld is out of bounds for array of length %lld\n", {lo, hi, length}, token);
+}
 
-	ctx->builder.SetInsertPoint(end);
+void LLVMCodeGen::trapUnless(llvm::Value *condition, const std::string &message, std::vector<llvm::Value*> args,
+		Token *token) {
+	static llvm::Type *result = ctx->builder.getInt32Ty();
+	static llvm::Type *fdArg = ctx->builder.getInt32Ty();
+	static llvm::Type *formatArg = ctx->builder.getInt8Ty()->getPointerTo();
+	static llvm::FunctionType *funcType = llvm::FunctionType::get(result, {fdArg, formatArg}, true);
+	const static llvm::FunctionCallee func = mi->module->getOrInsertFunction("dprintf", funcType);
+
+	boundsChecksInserted++;
+
+	llvm::BasicBlock *fail = llvm::BasicBlock::Create(ctx->context, "", function);
+	llvm::BasicBlock *pass = llvm::BasicBlock::Create(ctx->context, "", function);
+	auto weights = llvm::MDBuilder(ctx->context).createBranchWeights(2000, 1);
+	ctx->builder.CreateCondBr(condition, pass, fail, weights);
+
+	ctx->builder.SetInsertPoint(fail);
+	std::string location = currentFile;
+	if(token) {
+		location += ':' + std::to_string(token->row) + ':' + std::to_string(token->col);
+	}
+	auto format = ctx->builder.CreateGlobalStringPtr(location + ": " + message);
+	args.insert(args.begin(), {llvm::ConstantInt::get(fdArg, 2), format});
+	ctx->builder.CreateCall(func, args);
+	ctx->builder.CreateCall(llvm::Intrinsic::getDeclaration(mi->module.get(), llvm::Intrinsic::trap) );
+	ctx->builder.CreateUnreachable();
+
+	ctx->builder.SetInsertPoint(pass);
 }
 
 void LLVMCodeGen::freeArray(llvm::Instruction *array) {
-	static llvm::Value *llvmZero = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), llvm::APInt(32, 0) );
-	static llvm::Type *result = ctx->builder.getVoidTy();
-	static llvm::Type *argsRef = ctx->builder.getVoidTy()->getPointerTo();
-	static llvm::FunctionType *funcType = llvm::FunctionType::get(result, {argsRef}, false);
-	const static llvm::FunctionCallee func = mi->module->getOrInsertFunction("free", funcType);
+	callRuntime("ghoul_array_free", array, {getElementSize(array), getArrayAlignment(), getAllocator(array)});
+	clearArray(array);
+}
 
-	auto addr = llvm::GetElementPtrInst::CreateInBounds(array, {llvmZero, llvmZero} );
+void LLVMCodeGen::clearArray(llvm::Value *array) {
+	auto type = llvm::cast<llvm::PointerType>(array->getType() )->getElementType();
+	ctx->builder.CreateStore(llvm::Constant::getNullValue(type), array);
+}
 
-	ctx->builder.Insert(addr);
-	auto loadedAddr = ctx->builder.CreateLoad(addr);
-	auto cast = ctx->builder.CreatePointerCast(loadedAddr, argsRef);
-	ctx->builder.CreateCall(func, cast);
+VariableDeclareAstNode *LLVMCodeGen::getOwnedArray(const std::string &name) {
+	for(const auto &scope : ownedArrays) {
+		for(auto decl : scope) {
+			if(decl->identifier == name) {
+				return decl;
+			}
+		}
+	}
+	return nullptr;
 }
 
-void LLVMCodeGen::memcpy(llvm::Instruction *src, llvm::Instruction *dest, llvm::Value *length) {
-	//TODO: Draft for assignment function
-	llvm::BasicBlock *cond = llvm::BasicBlock::Create(ctx->context, "", function);
-	ctx->builder.CreateBr(cond);
-	ctx->builder.SetInsertPoint(cond);
+void LLVMCodeGen::freeOwnedArray(VariableDeclareAstNode &decl) {
+	auto array = (*locals)[decl.identifier];
+	if(decl.type.realignedArray) {
+		lastLLVMType = translateType(decl.type);
+		freeRAArray(array);
+	} else {
+		freeArray(array);
+	}
+}
 
-	llvm::BasicBlock *branch = llvm::BasicBlock::Create(ctx->context, "", function);
-	llvm::BasicBlock *end = llvm::BasicBlock::Create(ctx->context, "", function);
+void LLVMCodeGen::freeOwnedArrays(size_t fromScope) {
+	if(ctx->builder.GetInsertBlock()->getTerminator() ) {	//Scope already left through a return
+		return;
+	}
 
-	auto it = ctx->builder.CreateAlloca(ctx->builder.getInt32Ty() );
-	auto cmp = ctx->builder.CreateICmpEQ(it, length);
+	for(size_t i = ownedArrays.size(); i-- > fromScope; ) {
+		auto &scope = ownedArrays[i];
+		for(auto it = scope.rbegin(); it != scope.rend(); it++) {
+			freeOwnedArray(**it);
+		}
+	}
+}
 
-	ctx->builder.CreateCondBr(cmp, branch, end);
+void LLVMCodeGen::copyElements(llvm::Value *dest, llvm::Value *src, llvm::Value *count, bool mayOverlap) {
+	//A single intrinsic, lowered to the widest copy the target has
+	auto element = dest->getType()->getPointerElementType();
+	const auto &layout = mi->module->getDataLayout();
+	auto align = llvm::MaybeAlign(layout.getABITypeAlignment(element) );
+	auto bytes = ctx->builder.CreateMul(count, ctx->builder.getInt64(layout.getTypeAllocSize(element) ) );
+	if(mayOverlap) {
+		ctx->builder.CreateMemMove(dest, align, src, align, bytes);
+	} else {
+		ctx->builder.CreateMemCpy(dest, align, src, align, bytes);
+	}
+}
 
-	ctx->builder.SetInsertPoint(branch);
+void LLVMCodeGen::cloneArray(llvm::Instruction *target, llvm::Instruction *source) {
+	auto type = llvm::cast<llvm::StructType>(target->getType()->getPointerElementType() );
+	if(lhsIsRAArray) {	//One copy per column
+		auto length = getRAArrayLength(source);
+		ctx->builder.CreateStore(length, getArrayField(target, 0) );
+		ctx->builder.CreateStore(length, getArrayField(target, 1) );
+		auto columns = allocateColumns(type, length);
+		for(unsigned i = 2; i < type->getNumElements(); i++) {
+			copyElements(columns[i - 2], ctx->builder.CreateLoad(getArrayField(source, i) ), length, false);
+			ctx->builder.CreateStore(columns[i - 2], getArrayField(target, i) );
+		}
+		return;
+	}
 
-	llvm::Value *llvmZero = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), llvm::APInt(32, 0) );
+	auto length = getArrayLength(source);
+	auto data = allocateHeap(type->getElementType(0)->getPointerElementType(), length);
+	copyElements(data, getArrayData(source), length, false);
+	ctx->builder.CreateStore(data, getArrayField(target, 0) );
+	ctx->builder.CreateStore(length, getArrayField(target, 1) );
+	ctx->builder.CreateStore(length, getArrayField(target, 2) );
+}
+
+void LLVMCodeGen::transposeArray(llvm::Instruction *target, llvm::Instruction *source) {
+	//Into a new array of the other layout, the source keeps its elements
+	auto type = llvm::cast<llvm::StructType>(target->getType()->getPointerElementType() );
+	std::vector<llvm::Value*> columns;
+	llvm::Value *data = nullptr;
+	llvm::Value *length = nullptr;
+	bool toColumns = isRAArray(target);
+	if(toColumns) {
+		length = getArrayLength(source);
+		data = getArrayData(source);
+		columns = allocateColumns(type, length);
+		ctx->builder.CreateStore(length, getArrayField(target, 0) );
+		ctx->builder.CreateStore(length, getArrayField(target, 1) );
+		for(unsigned i = 2; i < type->getNumElements(); i++) {
+			ctx->builder.CreateStore(columns[i - 2], getArrayField(target, i) );
+		}
+	} else {
+		length = getRAArrayLength(source);
+		auto sourceType = source->getType()->getPointerElementType();
+		for(unsigned i = 2; i < sourceType->getStructNumElements(); i++) {
+			columns.push_back(ctx->builder.CreateLoad(getArrayField(source, i) ) );
+		}
+		data = allocateHeap(type->getElementType(0)->getPointerElementType(), length);
+		ctx->builder.CreateStore(data, getArrayField(target, 0) );
+		ctx->builder.CreateStore(length, getArrayField(target, 1) );
+		ctx->builder.CreateStore(length, getArrayField(target, 2) );
+	}
 
-	auto rhs = ctx->builder.CreateGEP(dest, {it, llvmZero} );
-	auto lhs = ctx->builder.CreateGEP(src, {it, llvmZero} );
-	auto loadedRhs = ctx->builder.CreateLoad(rhs);
-	ctx->builder.CreateStore(loadedRhs, lhs);
+	transposeElements(data, columns, length, toColumns);
+}
 
-	ctx->builder.CreateBr(cond);
-	ctx->builder.SetInsertPoint(end);
+void LLVMCodeGen::transposeElements(llvm::Value *data, const std::vector<llvm::Value*> &columns,
+		llvm::Value *length, bool toColumns) {
+	auto &builder = ctx->builder;
+	const auto &layout = mi->module->getDataLayout();
+	auto element = llvm::cast<llvm::StructType>(data->getType()->getPointerElementType() );
+	unsigned members = element->getNumElements();
+
+	//Elements of one number type without padding move in blocks of 4 or 8, a shuffle per column
+	auto scalar = element->getElementType(0);
+	bool uniform = (scalar->isIntegerTy() || scalar->isFloatingPointTy() ) && members > 1 && members <= 8
+		&& layout.getTypeAllocSize(element) == members * layout.getTypeAllocSize(scalar);
+	for(unsigned u = 1; uniform && u < members; u++) {
+		uniform = element->getElementType(u) == scalar;
+	}
+
+	auto function = builder.GetInsertBlock()->getParent();
+	auto entry = builder.GetInsertBlock();
+	auto zero = builder.getInt64(0);
+	llvm::Value *vectorEnd = zero;
+	if(uniform) {
+		unsigned lanes = layout.getTypeSizeInBits(scalar) <= 32 ? 8 : 4;
+		vectorEnd = builder.CreateAnd(length, builder.getInt64(~static_cast<uint64_t>(lanes - 1) ) );
+		auto columnType = llvm::FixedVectorType::get(scalar, lanes);
+		auto blockType = llvm::FixedVectorType::get(scalar, lanes * members);
+		auto align = llvm::Align(layout.getABITypeAlignment(scalar) );
+
+		auto header = llvm::BasicBlock::Create(ctx->context, "", function);
+		auto body = llvm::BasicBlock::Create(ctx->context, "", function);
+		auto end = llvm::BasicBlock::Create(ctx->context, "", function);
+		builder.CreateBr(header);
+		builder.SetInsertPoint(header);
+		auto i = builder.CreatePHI(builder.getInt64Ty(), 2);
+		i->addIncoming(zero, entry);
+		builder.CreateCondBr(builder.CreateICmpULT(i, vectorEnd), body, end);
+
+		builder.SetInsertPoint(body);
+		auto block = builder.CreatePointerCast(builder.CreateInBoundsGEP(data, i), blockType->getPointerTo() );
+		auto column = [&](unsigned u) {
+			auto first = builder.CreatePointerCast(columns[u], scalar->getPointerTo() );
+			return builder.CreatePointerCast(builder.CreateInBoundsGEP(first, i), columnType->getPointerTo() );
+		};
+		if(toColumns) {	//Lanes u, u + members, ... of the block are column u
+			auto values = builder.CreateAlignedLoad(blockType, block, align);
+			for(unsigned u = 0; u < members; u++) {
+				std::vector<int> mask;
+				for(unsigned lane = 0; lane < lanes; lane++) {
+					mask.push_back(lane * members + u);
+				}
+				builder.CreateAlignedStore(builder.CreateShuffleVector(values, values, mask), column(u), align);
+			}
+		} else {	//Columns are interleaved into the block one at a time
+			llvm::Value *values = llvm::UndefValue::get(blockType);
+			for(unsigned u = 0; u < members; u++) {
+				auto part = builder.CreateAlignedLoad(columnType, column(u), align);
+				std::vector<int> widen;
+				for(unsigned lane = 0; lane < lanes * members; lane++) {
+					widen.push_back(lane < lanes ? lane : -1);
+				}
+				std::vector<int> mask;
+				for(unsigned lane = 0; lane < lanes * members; lane++) {
+					mask.push_back(lane % members == u ? lanes * members + lane / members : lane);
+				}
+				auto wide = builder.CreateShuffleVector(part, part, widen);
+				values = builder.CreateShuffleVector(values, wide, mask);
+			}
+			builder.CreateAlignedStore(values, block, align);
+		}
+		i->addIncoming(builder.CreateAdd(i, builder.getInt64(lanes) ), builder.GetInsertBlock() );
+		builder.CreateBr(header);
+		builder.SetInsertPoint(end);
+	}
+
+	//The remainder, or every element of mixed members, one member at a time
+	auto before = builder.GetInsertBlock();
+	auto header = llvm::BasicBlock::Create(ctx->context, "", function);
+	auto body = llvm::BasicBlock::Create(ctx->context, "", function);
+	auto end = llvm::BasicBlock::Create(ctx->context, "", function);
+	builder.CreateBr(header);
+	builder.SetInsertPoint(header);
+	auto i = builder.CreatePHI(builder.getInt64Ty(), 2);
+	i->addIncoming(vectorEnd, before);
+	builder.CreateCondBr(builder.CreateICmpULT(i, length), body, end);
+
+	builder.SetInsertPoint(body);
+	for(unsigned u = 0; u < members; u++) {
+		auto member = builder.CreateInBoundsGEP(data, {i, builder.getInt32(u)});
+		auto cell = builder.CreateInBoundsGEP(columns[u], i);
+		auto lhs = toColumns ? cell : member;
+		auto rhs = toColumns ? member : cell;
+		if(element->getElementType(u)->isStructTy() ) {
+			assignStruct(lhs, rhs, element->getElementType(u) );
+		} else {
+			builder.CreateStore(builder.CreateLoad(rhs), lhs);
+		}
+	}
+	i->addIncoming(builder.CreateAdd(i, builder.getInt64(1) ), builder.GetInsertBlock() );
+	builder.CreateBr(header);
+	builder.SetInsertPoint(end);
+}
+
+void LLVMCodeGen::copyArray(llvm::Instruction *array, llvm::Instruction *source) {
+	if(lhsIsRAArray) {	//Cloned first, the source may be a slice of the array it replaces
+		auto type = array->getType()->getPointerElementType();
+		auto copy = allocateLocal(type);
+		cloneArray(copy, source);
+		lastLLVMType = type;
+		freeRAArray(array);
+		ctx->builder.CreateStore(ctx->builder.CreateLoad(copy), array);
+		return;
+	}
+
+	//Reuses the storage of the array, a slice of itself may overlap
+	auto length = getArrayLength(source);
+	reserveArray(array, length, false);
+	copyElements(getArrayData(array), getArrayData(source), length, true);
+	setArrayLength(array, length);
 }
 
 llvm::Type *LLVMCodeGen::getRAArrayType(llvm::Type *type, const Type &ghoulType) {
@@ -871,7 +1758,7 @@ llvm::Type *LLVMCodeGen::getRAArrayType(llvm::Type *type, const Type &ghoulType)
 	if(it == structTypes.end() ) {
 		arrayType = llvm::StructType::create(ctx->context, name);
 
-		std::vector<llvm::Type*> body = { ctx->builder.getInt32Ty(), ctx->builder.getInt32Ty() };
+		std::vector<llvm::Type*> body = { ctx->builder.getInt64Ty(), ctx->builder.getInt64Ty() };
 		//const Type *verboseType = mi->symtable->hasStruct(ghoulType.name);
 		//std::cerr << ghoulType.name << " " << verboseType << '\n';
 		//type->
@@ -886,8 +1773,16 @@ llvm::Type *LLVMCodeGen::getRAArrayType(llvm::Type *type, const Type &ghoulType)
 	
 		llvm::StructType *structTy = llvm::cast<llvm::StructType>(type);
 
-		for(auto ty : structTy->elements() ) {
-			body.push_back(ty->getPointerTo() );
+		if(ghoulType.tileSize > 0) {	//Blocks holding tileSize elements of each member in turn
+			std::vector<llvm::Type*> members;
+			for(auto ty : structTy->elements() ) {
+				members.push_back(llvm::ArrayType::get(ty, ghoulType.tileSize) );
+			}
+			body.push_back(llvm::StructType::create(ctx->context, members, name + ".block")->getPointerTo() );
+		} else {
+			for(auto ty : structTy->elements() ) {
+				body.push_back(ty->getPointerTo() );
+			}
 		}
 
 		arrayType->setBody(body);
@@ -901,6 +1796,7 @@ llvm::Type *LLVMCodeGen::getRAArrayType(llvm::Type *type, const Type &ghoulType)
 
 void LLVMCodeGen::createRAArray(ArrayAstNode &node) {
 	node.type.realignedArray = true;
+	node.type.tileSize = lastType && lastType->realignedArray ? lastType->tileSize : 0;	//Of the target
 	llvm::Type *arrayType = translateType(node.type);
 	lastLLVMType = arrayType;
 
@@ -910,7 +1806,7 @@ void LLVMCodeGen::createRAArray(ArrayAstNode &node) {
 			callParams.push_back(llvm::ConstantPointerNull::get(
 				llvm::cast<llvm::PointerType>(underlyingType) ) );
 		}
-		arrayLength = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), 0);
+		arrayLength = ctx->builder.getInt64(0);
 		return;
 	} 
 
@@ -919,30 +1815,95 @@ void LLVMCodeGen::createRAArray(ArrayAstNode &node) {
 	auto oldInsts = std::move(instructions);
 	auto oldLhs = lhsIsRAArray;
 	node.length->accept(*this);
-	arrayLength = callParams.back();
+	arrayLength = toLength(callParams.back(), *node.length);
 	callParams = std::move(oldVals);
 	instructions = std::move(oldInsts);
 	lhsIsRAArray = oldLhs;
 
+	auto tile = node.type.tileSize;
+	if(tile > 0) {	//Whole blocks, the last one may be partly used
+		auto blockType = arrayType->getStructElementType(2)->getPointerElementType();
+		if(node.stackLength > 0) {
+			callParams.push_back(allocateStack(blockType, (node.stackLength + tile - 1) / tile) );
+		} else {
+			auto blocks = ctx->builder.CreateUDiv(ctx->builder.CreateAdd(arrayLength,
+				ctx->builder.getInt64(tile - 1) ), ctx->builder.getInt64(tile) );
+			callParams.push_back(allocateHeap(blockType, blocks) );
+		}
+		return;
+	}
+
+	if(node.stackLength == 0) {
+		auto columns = allocateColumns(arrayType, arrayLength, currentAllocator);
+		callParams.insert(callParams.end(), columns.begin(), columns.end() );
+		return;
+	}
+
 	for(int i = 2; i < arrayType->getStructNumElements(); i++) {
-		llvm::Type *underlyingType = arrayType->getStructElementType(i);
-		auto ha = allocateHeap(underlyingType, arrayLength);
-		callParams.push_back(ha);
+		llvm::Type *columnType = arrayType->getStructElementType(i)->getPointerElementType();
+		callParams.push_back(allocateStack(columnType, node.stackLength) );
+	}
+}
+
+std::vector<llvm::Value*> LLVMCodeGen::allocateColumns(llvm::Type *arrayType, llvm::Value *capacity,
+		llvm::Value *allocator) {
+	//Laid out by the runtime into an empty header, growth moves the columns the same way
+	auto header = allocateLocal(arrayType);
+	clearArray(header);
+	callRuntime("ghoul_columns_reserve", header, {capacity,
+		ctx->builder.getInt32(arrayType->getStructNumElements() - 2), getColumnSizes(arrayType), getArrayAlignment(),
+		allocator ? allocator : getAllocator(header)});
+
+	std::vector<llvm::Value*> columns;
+	for(unsigned i = 2; i < arrayType->getStructNumElements(); i++) {
+		columns.push_back(ctx->builder.CreateLoad(getArrayField(header, i) ) );
 	}
+	return columns;
+}
+
+llvm::Value *LLVMCodeGen::getColumnSizes(llvm::Type *arrayType) {
+	//One constant table per realigned array type, read by the runtime
+	auto name = arrayType->getStructName().str() + ".sizes";
+	auto sizes = mi->module->getNamedGlobal(name);
+	if(!sizes) {
+		std::vector<uint64_t> values;
+		for(unsigned i = 2; i < arrayType->getStructNumElements(); i++) {
+			auto column = arrayType->getStructElementType(i)->getPointerElementType();
+			values.push_back(mi->module->getDataLayout().getTypeAllocSize(column) );
+		}
+		auto table = llvm::ConstantDataArray::get(ctx->context, values);
+		sizes = new llvm::GlobalVariable(*mi->module, table->getType(), true,
+			llvm::GlobalValue::PrivateLinkage, table, name);
+	}
+	return ctx->builder.CreateConstInBoundsGEP2_32(sizes->getValueType(), sizes, 0, 0);
 }
 
 void LLVMCodeGen::indexRAArray(IndexAstNode &node) {
+	llvm::Instruction *raArray = instructions.back();
 	auto prevType = lastType;
 	auto oldVals = std::move(callParams);
 	auto oldInsts = std::move(instructions);
+	auto oldAddrs = getAddrsVisited;
+	getAddrsVisited = 0;	//Index is a value even when the element's address is taken
 	node.index->accept(*this);
+	getAddrsVisited = oldAddrs;
 	lastType = prevType;
+	callParams.back() = toLength(callParams.back(), *node.index);
+
+	if(Global::config.boundsChecks) {
+		if(node.provenInBounds) {
+			boundsChecksElided++;
+		} else {
+			checkBounds(callParams.back(), getRAArrayLength(raArray), node.token);
+		}
+	}
 
 	oldVals.push_back(callParams.back() );
 
 	callParams = std::move(oldVals);
 	instructions = std::move(oldInsts);
 
+	visitedTileSize = lastType->tileSize;
 	lastType = lastType->arrayOf.get();
 	visitedRAAIndex = true;
 	for(auto &c : node.children) {
@@ -953,7 +1914,7 @@ void LLVMCodeGen::indexRAArray(IndexAstNode &node) {
 void LLVMCodeGen::indexRAArrayMember(MemberVariableAstNode &node) {
 	unsigned u = mi->symtable->getMemberOffset(*lastType, node.name);
 	auto llvmZero = llvm::ConstantInt::get(ctx->context, llvm::APInt(32, 0, true) );
-	auto structIndex = llvm::ConstantInt::get(ctx->context, llvm::APInt(32, u + 2, true) );
+	auto structIndex = llvm::ConstantInt::get(ctx->context, llvm::APInt(32, visitedTileSize > 0 ? 2 : u + 2, true) );
 	auto arrayIndex = callParams.back();
 
 	callParams.pop_back();
@@ -963,18 +1924,33 @@ void LLVMCodeGen::indexRAArrayMember(MemberVariableAstNode &node) {
 
 	ctx->builder.Insert(gep);
 	auto loadedGep = ctx->builder.CreateLoad(gep);
-
-	llvm::Instruction *element = llvm::GetElementPtrInst::CreateInBounds(loadedGep,
-		{arrayIndex} );
+	annotateDataPointer(loadedGep);
+
+	llvm::Instruction *element;
+	if(visitedTileSize > 0) {	//The member within its block, tile sizes are powers of two
+		auto tile = ctx->builder.getInt64(visitedTileSize);
+		auto memberIndex = llvm::ConstantInt::get(ctx->context, llvm::APInt(32, u, true) );
+		element = llvm::GetElementPtrInst::CreateInBounds(loadedGep, {ctx->builder.CreateUDiv(arrayIndex, tile),
+			memberIndex, ctx->builder.CreateURem(arrayIndex, tile)} );
+	} else {
+		element = llvm::GetElementPtrInst::CreateInBounds(loadedGep, {arrayIndex} );
+	}
 
 	ctx->builder.Insert(element);
+	scopeColumn(element, instructions.back(), u);
 
 	instructions.back() = element;
 	
 	lastType = mi->symtable->typeHasMember(*lastType, node.name);
 
 	if(node.children.empty() ) {
-		callParams.push_back(ctx->builder.CreateLoad(element) );
+		if(getAddrsVisited > 0) {
+			callParams.push_back(element);
+			return;
+		}
+		auto load = ctx->builder.CreateLoad(element);
+		annotateAccess(load, element, *lastType);
+		callParams.push_back(load);
 		return;
 	}
 	
@@ -1012,51 +1988,279 @@ llvm::Value *LLVMCodeGen::getRAArrayLength(llvm::Instruction *raArray) {
 	llvm::Value *llvmZero = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), llvm::APInt(32, 0) );
 	auto size = llvm::GetElementPtrInst::CreateInBounds(raArray, {llvmZero, llvmZero} );
 	ctx->builder.Insert(size);
-	return ctx->builder.CreateLoad(size);
+	auto length = ctx->builder.CreateLoad(size);
+	length->setMetadata(llvm::LLVMContext::MD_tbaa, getTBAATag("array length") );
+	return length;
 }
 
 void LLVMCodeGen::freeRAArray(llvm::Instruction *array) {
-	static llvm::Value *llvmZero = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), llvm::APInt(32, 0) );
-	static llvm::Type *result = ctx->builder.getVoidTy();
-	static llvm::Type *argsRef = ctx->builder.getVoidTy()->getPointerTo();
-	static llvm::FunctionType *funcType = llvm::FunctionType::get(result, {argsRef}, false);
-	const static llvm::FunctionCallee func = mi->module->getOrInsertFunction("free", funcType);
+	auto type = array->getType()->getPointerElementType();
+	callRuntime("ghoul_columns_free", array, {ctx->builder.getInt32(type->getStructNumElements() - 2),
+		getColumnSizes(type), getArrayAlignment(), getAllocator(array)});
+	clearArray(array);
+}
 
-	for(int i = 2; i < lastLLVMType->getStructNumElements(); i++) {
-		auto index = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), llvm::APInt(32, i) );
-		auto addr = llvm::GetElementPtrInst::CreateInBounds(array, {llvmZero, index} );
+bool LLVMCodeGen::isRAArray(llvm::Value *array) {
+	//Realigned headers start with their size, plain ones with the data pointer
+	auto type = array->getType()->getPointerElementType();
+	return type->isStructTy() && type->getStructElementType(0)->isIntegerTy();
+}
 
-		ctx->builder.Insert(addr);
-		auto loadedAddr = ctx->builder.CreateLoad(addr);
-		auto cast = ctx->builder.CreatePointerCast(loadedAddr, argsRef);
-		ctx->builder.CreateCall(func, cast);
+void LLVMCodeGen::assignStruct(llvm::Value *lhs, llvm::Value *rhs, llvm::Type *type) {
+	//Nested structs are copied with the rest, small ones as a single value
+	const auto &layout = mi->module->getDataLayout();
+	auto size = layout.getTypeAllocSize(type);
+	auto align = llvm::Align(layout.getABITypeAlignment(type) );
+	if(size <= 16) {
+		auto value = ctx->builder.CreateAlignedLoad(type, rhs, align);
+		ctx->builder.CreateAlignedStore(value, lhs, align);
+	} else {
+		ctx->builder.CreateMemCpy(lhs, align, rhs, align, size);
 	}
 }
 
-void LLVMCodeGen::assignStruct(llvm::Instruction *lhs, llvm::Value *rhs, llvm::Type *type) {
-	const static auto llvmZero = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), llvm::APInt(32, 0) );
-	llvm::StructType *strTy = llvm::cast<llvm::StructType>(type);
+void LLVMCodeGen::indexVector(IndexAstNode &node) {
+	auto llvmZero = ctx->builder.getInt32(0);
+	llvm::Instruction *vector = instructions.back();
+	auto prevType = lastType;
+	auto oldVals = std::move(callParams);
+	auto oldInsts = std::move(instructions);
+	auto oldAddrs = getAddrsVisited;
+	getAddrsVisited = 0;
+	node.index->accept(*this);
+	getAddrsVisited = oldAddrs;
+	auto index = toLength(callParams.back(), *node.index);
+	callParams = std::move(oldVals);
+	instructions = std::move(oldInsts);
+	lastType = mi->symtable->hasStruct(prevType->name);	//Lanes are scalars
 
-	for(int i = 0; i < strTy->getNumElements(); i++) {
-		const auto gepIndex = llvm::ConstantInt::get(ctx->builder.getInt32Ty(), llvm::APInt(32, i) );
-		auto memberTy = strTy->getStructElementType(i);
+	//Constant lanes were checked by the symbol pass
+	if(Global::config.boundsChecks && !llvm::isa<llvm::Constant>(index) ) {
+		checkBounds(index, ctx->builder.getInt64(prevType->lanes), node.token);
+	}
 
-		auto lhsGep = llvm::GetElementPtrInst::CreateInBounds(lhs, { llvmZero, gepIndex } );
-		auto rhsGep = llvm::GetElementPtrInst::CreateInBounds(rhs, { llvmZero, gepIndex } );
+	llvm::Instruction *lane = llvm::GetElementPtrInst::CreateInBounds(vector, {llvmZero, index} );
+	ctx->builder.Insert(lane);
+	instructions.back() = lane;
+
+	if(getAddrsVisited > 0) {
+		callParams.push_back(lane);
+	} else {
+		callParams.push_back(ctx->builder.CreateExtractElement(ctx->builder.CreateLoad(vector), index) );
+	}
+}
+
+void LLVMCodeGen::callBuiltin(CallAstNode &node) {
+	if(SymTable::isLayoutQuery(node.identifier) ) {
+		callParams.push_back(ctx->builder.getInt64(layoutQuery(node) ) );
+		return;
+	}
 
-		ctx->builder.Insert(lhsGep);
-		ctx->builder.Insert(rhsGep);
+	auto oldParams = std::move(callParams);
+	auto oldInsts = std::move(instructions);
+	std::vector<llvm::Value*> args;
+	for(const auto &child : node.children) {
+		child->accept(*this);
+		args.push_back(callParams.back() );
+		clear();
+	}
+	callParams = std::move(oldParams);
+	instructions = std::move(oldInsts);
 
-		auto rhsLoad = ctx->builder.CreateLoad(rhsGep);
+	auto &builder = ctx->builder;
+	const auto &name = node.identifier;
+	auto type = args.front()->getType();
+	bool isFloat = type->isFPOrFPVectorTy();
+	llvm::Value *result = nullptr;
+
+	if(name == "clone") {	//Array values such as call results are spilled to get a header address
+		auto source = llvm::dyn_cast<llvm::Instruction>(args[0]);
+		if(!args[0]->getType()->isPointerTy() ) {
+			source = allocateLocal(args[0]->getType() );
+			builder.CreateStore(args[0], source);
+		}
+		Type cloned = *lastType;	//The source, a slice clones into a whole array
+		cloned.isSlice = false;
+		cloned.isPtr = 0;
+		lhsIsRAArray = cloned.realignedArray;
+		auto copy = allocateLocal(translateType(cloned) );
+		cloneArray(copy, source);
+		result = copy;
+	} else if(name == "transpose") {	//Spilled the same way, the copy takes the other layout
+		auto source = llvm::dyn_cast<llvm::Instruction>(args[0]);
+		if(!args[0]->getType()->isPointerTy() ) {
+			source = allocateLocal(args[0]->getType() );
+			builder.CreateStore(args[0], source);
+		}
+		Type transposed = *lastType;
+		transposed.isSlice = false;
+		transposed.isPtr = 0;
+		transposed.realignedArray = !transposed.realignedArray;
+		auto copy = allocateLocal(translateType(transposed) );
+		transposeArray(copy, source);
+		result = copy;
+	} else if(name == "reserve" || name == "resize" || name == "append" || name == "shrink" || name == "copy") {
+		auto array = llvm::cast<llvm::Instruction>(args[0]);
+		if(name == "reserve") {
+			reserveArray(array, toLength(args[1], *node.children[1]), false);
+		} else if(name == "resize") {
+			resizeArray(array, toLength(args[1], *node.children[1]) );
+		} else if(name == "shrink") {
+			shrinkArray(array);
+		} else {	//Array values such as call results are spilled to get a header address
+			auto source = llvm::dyn_cast<llvm::Instruction>(args[1]);
+			if(!args[1]->getType()->isPointerTy() ) {
+				source = allocateLocal(args[1]->getType() );
+				builder.CreateStore(args[1], source);
+			}
 
-		if(auto subStruct = llvm::dyn_cast<llvm::StructType>(memberTy) ) {
-			assignStruct(lhsGep, rhsLoad, subStruct);
+			if(name == "copy") {
+				lhsIsRAArray = isRAArray(array);
+				copyArray(array, source);
+			} else {
+				appendArray(array, source);
+			}
+		}
+	} else if(name == "shuffle") {
+		std::vector<int> mask;
+		for(size_t i = 2; i < node.children.size(); i++) {
+			mask.push_back(static_cast<IntAstNode&>(*node.children[i]).value);
+		}
+		result = builder.CreateShuffleVector(args[0], args[1], mask);
+	} else if(name == "reduceAdd") {
+		result = isFloat
+			? builder.CreateFAddReduce(llvm::ConstantFP::get(type->getScalarType(), -0.0), args[0])
+			: builder.CreateAddReduce(args[0]);
+	} else if(name == "reduceMul") {
+		result = isFloat
+			? builder.CreateFMulReduce(llvm::ConstantFP::get(type->getScalarType(), 1.0), args[0])
+			: builder.CreateMulReduce(args[0]);
+	} else if(name == "reduceMin") {
+		result = isFloat ? builder.CreateFPMinReduce(args[0]) : builder.CreateIntMinReduce(args[0], true);
+	} else if(name == "reduceMax") {
+		result = isFloat ? builder.CreateFPMaxReduce(args[0]) : builder.CreateIntMaxReduce(args[0], true);
+	} else if(name == "any") {
+		result = builder.CreateOrReduce(args[0]);
+	} else if(name == "all") {
+		result = builder.CreateAndReduce(args[0]);
+	} else {	//Lanes in memory, starting at an element. Only that element is bounds checked
+		auto element = type->getPointerElementType();
+		unsigned lanes = name == "loadLanes"
+			? static_cast<IntAstNode&>(*node.children[1]).value
+			: llvm::cast<llvm::FixedVectorType>(args[1]->getType() )->getNumElements();
+		auto vectorType = llvm::FixedVectorType::get(element, lanes);
+		auto address = builder.CreatePointerCast(args[0], vectorType->getPointerTo() );
+		auto align = llvm::Align(mi->module->getDataLayout().getABITypeAlignment(element) );
+		auto tag = getTBAATag(element->isDoubleTy() ? "double" : element->isFloatTy() ? "float"
+			: element->isIntegerTy(8) ? "char" : "int");
+
+		llvm::Instruction *access = nullptr;
+		if(name == "loadLanes") {
+			access = builder.CreateAlignedLoad(vectorType, address, align);
+			result = access;
+		} else if(name == "storeLanes") {
+			access = builder.CreateAlignedStore(args[1], address, align);
+		} else if(name == "loadMasked") {
+			access = builder.CreateMaskedLoad(address, align, args[1], llvm::Constant::getNullValue(vectorType) );
+			result = access;
 		} else {
-			ctx->builder.CreateStore(rhsLoad, lhsGep);
+			access = builder.CreateMaskedStore(args[1], address, align, args[2]);
 		}
+		access->setMetadata(llvm::LLVMContext::MD_tbaa, tag);
+	}
+
+	if(result) {
+		callParams.push_back(result);
 	}
 }
 
+llvm::MDNode *LLVMCodeGen::getTBAATag(const std::string &name) {
+	auto it = tbaaTags.find(name);
+	if(it != tbaaTags.end() ) {
+		return it->second;
+	}
+
+	llvm::MDBuilder builder(ctx->context);
+	if(!tbaaChar) {
+		tbaaChar = builder.createTBAAScalarTypeNode("char", builder.createTBAARoot("Ghoul TBAA") );
+	}
+
+	//Like in C, char may alias anything
+	auto type = name == "char" ? tbaaChar : builder.createTBAAScalarTypeNode(name, tbaaChar);
+	auto tag = builder.createTBAAStructTagNode(type, type, 0);
+	tbaaTags[name] = tag;
+	return tag;
+}
+
+llvm::MDNode *LLVMCodeGen::getTBAATag(const Type &type) {
+	if(type.isPtr > 0) {
+		return getTBAATag("any pointer");
+	} else if(type.isStruct() ) {	//Loaded, stored and memcpy'd as a whole object, so it may alias any member
+		return getTBAATag("char");
+	}
+
+	//Signed and unsigned integers of the same width may alias, like in C
+	static const Map<std::string> signedNames = {
+		{"u8", "char"}, {"u32", "int"}, {"u64", "i64"}
+	};
+	auto it = signedNames.find(type.name);
+	return getTBAATag(it != signedNames.end() ? it->second : type.name);
+}
+
+void LLVMCodeGen::annotateAccess(llvm::Instruction *access, llvm::Value *ptr, const Type &type) {
+	auto store = llvm::dyn_cast<llvm::StoreInst>(access);
+	auto accessed = store ? store->getValueOperand()->getType() : access->getType();
+
+	//Only tag accesses that really are of the given type, not e.g. stores through '&'
+	auto tag = getTBAATag(type);
+	if(tag && accessed == translateType(type) ) {
+		access->setMetadata(llvm::LLVMContext::MD_tbaa, tag);
+	}
+
+	auto scopes = columnAccesses.find(ptr);
+	if(scopes != columnAccesses.end() ) {
+		access->setMetadata(llvm::LLVMContext::MD_alias_scope, scopes->second.first);
+		access->setMetadata(llvm::LLVMContext::MD_noalias, scopes->second.second);
+	}
+}
+
+void LLVMCodeGen::annotateDataPointer(llvm::LoadInst *load) {
+	//Indexed arrays always have storage, aligned for their elements at least.
+	//Slices passed as arrays start anywhere, so the array alignment is not claimed
+	auto elementType = load->getType()->getPointerElementType();
+	auto align = mi->module->getDataLayout().getABITypeAlignment(elementType);
+	load->setMetadata(llvm::LLVMContext::MD_tbaa, getTBAATag("array data") );
+	load->setMetadata(llvm::LLVMContext::MD_nonnull, llvm::MDNode::get(ctx->context, {}) );
+	load->setMetadata(llvm::LLVMContext::MD_align, llvm::MDNode::get(ctx->context,
+		{llvm::ConstantAsMetadata::get(ctx->builder.getInt64(align) )}) );
+}
+
+void LLVMCodeGen::scopeColumn(llvm::Value *element, llvm::Value *raArray, unsigned column) {
+	//Columns of a realigned array never overlap, neither do the members of a block in a tiled one
+	auto type = llvm::cast<llvm::StructType>(raArray->getType()->getPointerElementType() );
+	unsigned columns = visitedTileSize > 0
+		? type->getElementType(2)->getPointerElementType()->getStructNumElements()
+		: type->getNumElements() - 2;
+	auto &scopes = columnScopes[type->getName().str()];
+	if(scopes.empty() ) {
+		llvm::MDBuilder builder(ctx->context);
+		auto domain = builder.createAnonymousAliasScopeDomain(type->getName() );
+		for(unsigned i = 0; i < columns; i++) {
+			scopes.push_back(builder.createAnonymousAliasScope(domain) );
+		}
+	}
+
+	std::vector<llvm::Metadata*> others;
+	for(unsigned i = 0; i < scopes.size(); i++) {
+		if(i != column) {
+			others.push_back(scopes[i]);
+		}
+	}
+
+	columnAccesses[element] = {llvm::MDNode::get(ctx->context, {scopes[column]}),
+		llvm::MDNode::get(ctx->context, others)};
+}
+
 llvm::Instruction *LLVMCodeGen::loadUntilLastPtr(llvm::Instruction *inst) {
 	//return inst;
 
@@ -1084,6 +2288,11 @@ bool gen(ModuleInfo *mi, Context *ctx) {
 	llvm::InitializeAllAsmParsers();
 	llvm::InitializeAllAsmPrinters();
 
+	//Struct layouts and allocation sizes are those of the target from the start
+	auto machine = hostMachine();
+	mi->module->setDataLayout(machine->createDataLayout() );
+	mi->module->setTargetTriple(machine->getTargetTriple().str() );
+
 	LLVMCodeGen codeGen;
 	codeGen.setContext(ctx);
 	codeGen.setModuleInfo(mi);
@@ -1093,6 +2302,11 @@ bool gen(ModuleInfo *mi, Context *ctx) {
 	}
 	codeGen.visit(*mi->ast);
 
+	if(Global::config.boundsChecks) {
+		std::cout << "Bounds checks: " << codeGen.getBoundsChecksInserted() << " inserted, "
+			<< codeGen.getBoundsChecksElided() << " proven redundant and removed\n";
+	}
+
 	if(Global::config.verbose || Global::config.verboseIR) {
 		mi->module->print(llvm::errs(), nullptr);
 	}
@@ -1101,11 +2315,63 @@ bool gen(ModuleInfo *mi, Context *ctx) {
 	return true;
 }
 
-void write(ModuleInfo *mi, Context *ctx) {
+//Reports why loop hints could not be honored, along with other diagnostics of the optimizer
+static void printDiagnostic(const llvm::DiagnosticInfo &info, void *) {
+	static const char *severities[] = {"error", "warning", "remark", "note"};
 
-	auto targetTriple = llvm::sys::getDefaultTargetTriple();
-	mi->module->setTargetTriple(targetTriple);
+	std::string message;
+	llvm::raw_string_ostream stream(message);
+	if(auto opt = llvm::dyn_cast<llvm::DiagnosticInfoOptimizationBase>(&info) ) {
+		stream << "In function '" << opt->getFunction().getName() << "': " << opt->getMsg();
+	} else {
+		llvm::DiagnosticPrinterRawOStream printer(stream);
+		info.print(printer);
+	}
 
+	std::cerr << severities[info.getSeverity()] << ": " << stream.str() << '\n';
+}
+
+void optimize(ModuleInfo *mi, llvm::TargetMachine *machine) {
+	mi->module->getContext().setDiagnosticHandlerCallBack(printDiagnostic, nullptr, true);
+
+	llvm::PassManagerBuilder builder;
+	builder.OptLevel = std::min(Global::config.optLevel, 3u);
+	builder.Inliner = builder.OptLevel > 0
+		? llvm::createFunctionInliningPass(builder.OptLevel, 0, false)
+		: llvm::createAlwaysInlinerLegacyPass();
+	machine->adjustPassManager(builder);
+
+	llvm::legacy::FunctionPassManager functionPasses(mi->module.get() );
+	llvm::legacy::PassManager modulePasses;
+	functionPasses.add(llvm::createTargetTransformInfoWrapperPass(machine->getTargetIRAnalysis() ) );
+	modulePasses.add(llvm::createTargetTransformInfoWrapperPass(machine->getTargetIRAnalysis() ) );
+
+	//Every local is an alloca, keep them in registers even without optimizations
+	functionPasses.add(llvm::createSROAPass() );
+	functionPasses.add(llvm::createPromoteMemoryToRegisterPass() );
+	builder.populateFunctionPassManager(functionPasses);
+	builder.populateModulePassManager(modulePasses);
+
+	functionPasses.doInitialization();
+	for(auto &func : *mi->module) {
+		functionPasses.run(func);
+	}
+	functionPasses.doFinalization();
+	modulePasses.run(*mi->module);
+
+	if(builder.OptLevel > 0 && (Global::config.verbose || Global::config.verboseIR) ) {
+		std::cerr << "Optimized IR:\n";
+		mi->module->print(llvm::errs(), nullptr);
+	}
+}
+
+llvm::TargetMachine *hostMachine() {
+	static llvm::TargetMachine *machine = nullptr;
+	if(machine) {
+		return machine;
+	}
+
+	auto targetTriple = llvm::sys::getDefaultTargetTriple();
 	std::string err;
 	auto target = llvm::TargetRegistry::lookupTarget(targetTriple, err);
 
@@ -1113,15 +2379,27 @@ void write(ModuleInfo *mi, Context *ctx) {
 		std::cerr << err << '\n';
 	}
 
-	auto cpu = "generic";
-	auto features = "";
+	//Tune for the host like -march=native, vectors get the widest native registers
+	auto cpu = llvm::sys::getHostCPUName();
+	llvm::SubtargetFeatures features;
+	llvm::StringMap<bool> hostFeatures;
+	if(llvm::sys::getHostCPUFeatures(hostFeatures) ) {
+		for(const auto &feature : hostFeatures) {
+			features.AddFeature(feature.first(), feature.second);
+		}
+	}
 
 	llvm::TargetOptions opt;
 	auto RM = llvm::Optional<llvm::Reloc::Model>(llvm::Reloc::Model::DynamicNoPIC);
-	auto theTargetMachine = target->createTargetMachine(targetTriple, cpu, features, opt, RM);
+	auto level = Global::config.optLevel > 0 ? llvm::CodeGenOpt::Default : llvm::CodeGenOpt::None;
+	machine = target->createTargetMachine(targetTriple, cpu, features.getString(), opt, RM,
+			llvm::None, level);
+	return machine;
+}
 
-	mi->module->setDataLayout(theTargetMachine->createDataLayout() );
-	mi->module->setTargetTriple(targetTriple);
+void write(ModuleInfo *mi, Context *ctx) {
+	auto theTargetMachine = hostMachine();
+	optimize(mi, theTargetMachine);
 
 	std::error_code ec;
 	llvm::raw_fd_ostream dest(mi->objName, ec, llvm::sys::fs::F_None);
@@ -1136,19 +2414,22 @@ void write(ModuleInfo *mi, Context *ctx) {
 
 	pass.run(*mi->module);
 
-	/*
-	if(Global::config.verbose || Global::config.verboseIR) {
-		std::cerr << "Optimized IR:\n";
-		mi->module->print(llvm::errs(), nullptr);
-	}
-	*/
-
 	dest.flush();
 
 	std::cout << "Object written to " << mi->objName << '\n';
 	link(mi, ctx);
 }
 
+static std::string findRuntimePath() {
+	//Next to the compiler in a build tree, otherwise where it was installed
+	std::error_code error;
+	auto local = std::filesystem::read_symlink("/proc/self/exe", error).parent_path() / "runtime";
+	if(!error && std::filesystem::exists(local / "libghoulrt.a") ) {
+		return local;
+	}
+	return GHOUL_RUNTIME_DIR;
+}
+
 void link(ModuleInfo *mi, Context *ctx) {
 	std::cout << "Linking to " << mi->name << '\n';
 	std::string link;
@@ -1156,5 +2437,6 @@ void link(ModuleInfo *mi, Context *ctx) {
 		link += " -l";
 		link += str;
 	}
-	system((std::string("gcc -O0 ") + mi->objName + " -o " + mi->name + link).c_str() );
+	system((std::string("gcc -O0 ") + mi->objName + " -o " + mi->name
+		+ " -L" + findRuntimePath() + " -lghoulrt" + link).c_str() );
 }
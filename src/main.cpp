@@ -10,6 +10,9 @@
 #include "argparser.hpp"
 #include "astprint.hpp"
 #include "frontend.hpp"
+#include "escape.hpp"
+#include "ownership.hpp"
+#include "effects.hpp"
 
 
 void buildModuleInfo(ModuleInfo &mi, std::string_view sv) {
@@ -28,6 +31,28 @@ void compile(ModuleInfo &mi) {
 	float time;
 	Clock clock;
 
+	EscapeAnalysis escapeAnalysis(mi.symtable);
+	escapeAnalysis.visit(*mi.ast);
+	time = clock.getNanoSeconds();
+	std::cout << mi.fileName << " escape analysis completed in " << time << " ns\n";
+	if(!Global::errStack.empty() ) {
+		Global::errStack.unwind();
+		exit(EXIT_FAILURE);
+	}
+
+	clock.restart();
+	OwnershipAnalysis ownershipAnalysis;
+	ownershipAnalysis.visit(*mi.ast);
+	time = clock.getNanoSeconds();
+	std::cout << mi.fileName << " ownership analysis completed in " << time << " ns\n";
+
+	clock.restart();
+	EffectAnalysis effectAnalysis(mi.symtable);
+	effectAnalysis.visit(*mi.ast);
+	time = clock.getNanoSeconds();
+	std::cout << mi.fileName << " effect analysis completed in " << time << " ns\n";
+
+	clock.restart();
 	if(!gen(&mi, &ctx) ) {
 		exit(EXIT_FAILURE);
 	}
@@ -52,6 +77,7 @@ int main(int argc, char** argv) {
 
 	ModuleInfo mi;
 	std::string buildFlag;
+	std::string growthFlag = "2x";
 
 	ArgParser argParser(argc, argv);
 	argParser.addString(&buildFlag, "build");
@@ -60,9 +86,33 @@ int main(int argc, char** argv) {
 	argParser.addBool(&Global::config.verboseAst, "--verbose-ast");
 	argParser.addBool(&Global::config.verboseSymtable, "--verbose-symtable");
 	argParser.addBool(&Global::config.verboseIR, "--verbose-ir");
+	argParser.addBool(&Global::config.verboseEscape, "--verbose-escape");
+	argParser.addBool(&Global::config.layoutReport, "--layout-report");
+	argParser.addBool(&Global::config.fastMath, "--fast-math");
+	argParser.addBool(&Global::config.boundsChecks, "--bounds-checks");
+	argParser.addUnsigned(&Global::config.optLevel, "-O");
+	argParser.addUnsigned(&Global::config.arrayAlignment, "--array-align");
+	argParser.addString(&growthFlag, "--growth");
 
 	argParser.unwind();
 
+	if(growthFlag == "2x") {
+		Global::config.growth = Growth::Double;
+	} else if(growthFlag == "1.5x") {
+		Global::config.growth = Growth::Half;
+	} else if(growthFlag == "page") {
+		Global::config.growth = Growth::Page;
+	} else {
+		std::cerr << "Unknown growth policy " << growthFlag << ", expected 2x, 1.5x or page\n";
+		return EXIT_FAILURE;
+	}
+
+	unsigned align = Global::config.arrayAlignment;
+	if(align < 8 || align > 4096 || (align & (align - 1) ) != 0) {
+		std::cerr << "Array alignment " << align << " must be a power of two from 8 to 4096\n";
+		return EXIT_FAILURE;
+	}
+
 	if(!buildFlag.empty() ) {
 		buildModuleInfo(mi, buildFlag);
 		compile(mi);
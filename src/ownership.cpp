@@ -0,0 +1,364 @@
+#include "ownership.hpp"
+#include "symtable.hpp"
+
+#include <algorithm>
+
+static VariableAstNode *plainVariable(AstNode *node) {
+	auto var = dynamic_cast<VariableAstNode*>(node);
+	return var && var->children.empty() ? var : nullptr;
+}
+
+void OwnershipAnalysis::visit(ToplevelAstNode &node) {
+	collectFunctions(node);
+	for(const auto &child : node.children) {
+		child->accept(*this);
+	}
+}
+
+void OwnershipAnalysis::visit(LinkAstNode &node) {
+
+}
+
+void OwnershipAnalysis::visit(StructAstNode &node) {
+
+}
+
+void OwnershipAnalysis::visit(FunctionAstNode &node) {
+	//May already have been analyzed when looking at a call
+	if(owningReturns.count(node.signature.name) == 0) {
+		analyze(node);
+	}
+}
+
+void OwnershipAnalysis::visit(ExternAstNode &node) {
+
+}
+
+void OwnershipAnalysis::visit(VariableDeclareAstNode &node) {
+	auto &frame = frames.back();
+	//Region arrays go away with their arena block instead
+	bool isCandidate = node.type.arrayOf && node.type.isPtr == 0 && !node.type.isSlice && !node.region
+		&& frame.function->stackArrays.count(node.identifier) == 0;
+	if(isCandidate) {
+		frame.candidates[node.identifier] = &node;
+		frame.sources[node.identifier];
+	}
+	frame.declared[node.identifier] = ++frame.uses;
+
+	if(node.children.empty() ) {	//Starts out empty
+		return;
+	}
+
+	//First child is binary expr (assignment), assignments rhs is the initializer
+	auto &init = node.children.front()->children.back();
+	if(isCandidate) {
+		frame.sources[node.identifier].push_back(init.get() );
+	}
+	consume(init);
+}
+
+void OwnershipAnalysis::visit(ReturnAstNode &node) {
+	for(auto &child : node.children) {
+		frames.back().returns.push_back(child.get() );
+		consume(child, true);
+	}
+}
+
+void OwnershipAnalysis::visit(BranchAstNode &node) {
+	node.expr->accept(*this);
+	for(const auto &child : node.children) {
+		child->accept(*this);
+	}
+}
+
+void OwnershipAnalysis::visit(ArenaAstNode &node) {
+	for(const auto &child : node.children) {
+		child->accept(*this);
+	}
+}
+
+void OwnershipAnalysis::visit(LoopAstNode &node) {
+	if(node.loopPrefix) {
+		node.loopPrefix->accept(*this);
+	}
+
+	//Anything used inside the loop is used again by the next iteration
+	frames.back().loops.push_back(++frames.back().uses);
+	node.expr->accept(*this);
+
+	if(node.loopSuffix) {
+		node.loopSuffix->accept(*this);
+	}
+
+	for(const auto &child : node.children) {
+		child->accept(*this);
+	}
+	frames.back().loops.pop_back();
+}
+
+void OwnershipAnalysis::visit(CallAstNode &node) {
+	if(SymTable::isLayoutQuery(node.identifier) ) {	//Arguments are names, never evaluated
+		return;
+	}
+
+	for(size_t i = 0; i < node.children.size(); i++) {
+		auto &arg = node.children[i];
+		if(!arg) {
+			continue;
+		}
+
+		//Lending an array through '*' keeps the caller as its owner
+		auto un = dynamic_cast<UnaryExpressionAstNode*>(arg.get() );
+		auto lent = un && un->type == TokenType::Multiply ? plainVariable(un->children.front().get() ) : nullptr;
+		if(lent) {
+			noteUse(lent->name);
+			continue;
+		}
+
+		//So does lending a slice of it for the duration of the call
+		auto var = dynamic_cast<VariableAstNode*>(arg.get() );
+		auto index = var && !var->children.empty() ? dynamic_cast<IndexAstNode*>(var->children.front().get() ) : nullptr;
+		if(index && index->isSlice) {
+			noteUse(var->name);
+			continue;
+		}
+
+		//A header handed over by value is shared with a callee that may return or store it
+		auto value = plainVariable(arg.get() );
+		if(value && mayKeep(node.identifier, i) ) {
+			frames.back().exposed.insert(value->name);
+		}
+
+		arg->accept(*this);
+	}
+}
+
+void OwnershipAnalysis::visit(BinExpressionAstNode &node) {
+	auto &frame = frames.back();
+	auto target = plainVariable(node.children.front().get() );
+	auto value = plainVariable(node.children.back().get() );
+	if(node.type == TokenType::Push && value) {	//Pushed arrays end up shared with the element
+		frame.exposed.insert(value->name);
+	}
+
+	if(node.type != TokenType::Assign) {
+		for(const auto &child : node.children) {
+			child->accept(*this);
+		}
+		return;
+	}
+
+	if(target && value && target->name == value->name) {	//Self assignment, nothing moves
+		noteUse(value->name);
+		return;
+	}
+
+	if(target && frame.candidates.count(target->name) > 0) {
+		frame.sources[target->name].push_back(node.children.back().get() );
+	} else {
+		node.children.front()->accept(*this);
+	}
+
+	consume(node.children.back() );
+}
+
+void OwnershipAnalysis::visit(UnaryExpressionAstNode &node) {
+	//An address that is kept around may outlive a scope based free
+	auto target = node.children.empty() ? nullptr : plainVariable(node.children.front().get() );
+	if(node.type == TokenType::Multiply && target) {
+		frames.back().exposed.insert(target->name);
+		noteUse(target->name);
+		return;
+	}
+
+	for(const auto &child : node.children) {
+		child->accept(*this);
+	}
+}
+
+void OwnershipAnalysis::visit(CastExpressionAstNode &node) {
+	for(const auto &child : node.children) {
+		child->accept(*this);
+	}
+}
+
+void OwnershipAnalysis::visit(ArrayAstNode &node) {
+	if(node.length) {
+		node.length->accept(*this);
+	}
+}
+
+void OwnershipAnalysis::visit(IndexAstNode &node) {
+	node.index->accept(*this);
+	if(node.end) {
+		node.end->accept(*this);
+	}
+	for(const auto &child : node.children) {
+		child->accept(*this);
+	}
+}
+
+void OwnershipAnalysis::visit(MemberVariableAstNode &node) {
+	for(const auto &child : node.children) {
+		child->accept(*this);
+	}
+}
+
+void OwnershipAnalysis::visit(VariableAstNode &node) {
+	noteUse(node.name);
+
+	//A slice that is kept around may outlive a scope based free
+	auto index = node.children.empty() ? nullptr : dynamic_cast<IndexAstNode*>(node.children.front().get() );
+	if(index && index->isSlice) {
+		frames.back().exposed.insert(node.name);
+	}
+
+	for(const auto &child : node.children) {
+		child->accept(*this);
+	}
+}
+
+void OwnershipAnalysis::visit(StringAstNode &node) {
+
+}
+
+void OwnershipAnalysis::visit(IntAstNode &node) {
+
+}
+
+void OwnershipAnalysis::visit(FloatAstNode &node) {
+
+}
+
+void OwnershipAnalysis::visit(BoolAstNode &node) {
+
+}
+
+void OwnershipAnalysis::collectFunctions(ToplevelAstNode &node) {
+	for(auto func : node.functions) {
+		functions.insert({func->signature.name, func});
+	}
+	for(auto toplevel : node.toplevels) {
+		collectFunctions(*toplevel);
+	}
+}
+
+void OwnershipAnalysis::analyze(FunctionAstNode &node) {
+	//Assume the worst while the function is in progress, this covers recursion
+	owningReturns[node.signature.name] = false;
+
+	frames.emplace_back();
+	frames.back().function = &node;
+	for(const auto &child : node.children) {
+		child->accept(*this);
+	}
+
+	Frame frame = std::move(frames.back() );
+	frames.pop_back();
+	finish(frame);
+}
+
+void OwnershipAnalysis::finish(Frame &frame) {
+	//Reading an array whole only moves it when nothing reads the source afterwards,
+	//otherwise both names share the array and it is left to manual management
+	for(const auto &move : frame.moves) {
+		auto &name = move.var->name;
+		bool inLoop = move.loop > 0 && move.loop > frame.declared[name];
+		if(!move.isReturn && (frame.lastUses[name] != move.use || inLoop) ) {
+			frame.exposed.insert(name);
+		}
+	}
+
+	Names owned;
+	for(const auto &candidate : frame.candidates) {
+		if(frame.exposed.count(candidate.first) == 0) {
+			owned.insert(candidate.first);
+		}
+	}
+
+	//An array is only owned if everything ever stored into it is owned as well
+	for(bool changed = true; changed; ) {
+		changed = false;
+		for(auto it = owned.begin(); it != owned.end(); ) {
+			auto &sources = frame.sources[*it];
+			bool owning = std::all_of(sources.begin(), sources.end(), [&](AstNode *source) {
+				return isOwning(source, owned);
+			});
+
+			if(owning) {
+				it++;
+			} else {
+				it = owned.erase(it);
+				changed = true;
+			}
+		}
+	}
+
+	for(const auto &name : owned) {
+		frame.candidates[name]->owned = true;
+	}
+
+	for(const auto &move : frame.moves) {
+		move.var->moved = owned.count(move.var->name) > 0;
+	}
+
+	auto &sig = frame.function->signature;
+	owningReturns[sig.name] = sig.returnType.arrayOf && sig.returnType.isPtr == 0 && !sig.returnType.isSlice
+		&& std::all_of(frame.returns.begin(), frame.returns.end(), [&](AstNode *value) {
+			return isOwning(value, owned);
+		});
+}
+
+void OwnershipAnalysis::consume(AstNode::Child &value, bool isReturn) {
+	auto &frame = frames.back();
+	if(auto var = plainVariable(value.get() ) ) {
+		noteUse(var->name);
+		frame.moves.push_back({var, frame.uses, frame.loops.empty() ? 0 : frame.loops.back(), isReturn});
+	} else {
+		value->accept(*this);
+	}
+}
+
+void OwnershipAnalysis::noteUse(const std::string &name) {
+	auto &frame = frames.back();
+	frame.lastUses[name] = ++frame.uses;
+}
+
+bool OwnershipAnalysis::isOwning(AstNode *value, const Names &owned) {
+	if(dynamic_cast<ArrayAstNode*>(value) ) {
+		return true;
+	}
+
+	if(auto call = dynamic_cast<CallAstNode*>(value) ) {
+		return call->identifier == "clone" || call->identifier == "transpose" || returnsOwning(call->identifier);
+	}
+
+	auto var = plainVariable(value);
+	return var && owned.count(var->name) > 0;
+}
+
+bool OwnershipAnalysis::mayKeep(const std::string &callee, size_t index) const {
+	if(SymTable::isBuiltin(callee) ) {
+		return false;
+	}
+
+	auto it = functions.find(callee);
+	if(it == functions.end() ) {	//Externs are opaque
+		return true;
+	}
+
+	auto &kept = it->second->keptParams;
+	return index >= kept.size() || kept[index];
+}
+
+bool OwnershipAnalysis::returnsOwning(const std::string &callee) {
+	auto it = functions.find(callee);
+	if(it == functions.end() ) {	//Externs never hand out arrays we own
+		return false;
+	}
+
+	if(owningReturns.count(callee) == 0) {
+		analyze(*it->second);
+	}
+	return owningReturns[callee];
+}
@@ -1,6 +1,35 @@
 #include "symtable.hpp"
 #include "astprint.hpp"
 
+#include <algorithm>
+#include <climits>
+
+//Whether a value of this type could lead a callee to an array header
+static bool mayReachArray(const Type &type) {
+	if(type.arrayOf) {
+		return true;
+	}
+	if(type.name == "void") {
+		return type.isPtr > 0;
+	}
+	return !Type::isPrimitive(type.name);
+}
+
+//Lets code generation pick between sign and zero extension of the expression
+static void markUnsigned(AstNode &expr, const Type &type) {
+	if(auto expression = dynamic_cast<ExpressionAstNode*>(&expr) ) {
+		expression->isUnsigned = type.isUnsigned();
+	}
+}
+
+//The wider of two integer types, the unsigned one if both are as wide, like in C
+static Type promote(const Type &lhs, const Type &rhs) {
+	if(lhs.size() != rhs.size() ) {
+		return lhs.size() > rhs.size() ? lhs : rhs;
+	}
+	return lhs.isUnsigned() ? lhs : rhs;
+}
+
 //Default types
 SymTable::SymTable() {
 	Type type;
@@ -12,8 +41,16 @@ SymTable::SymTable() {
 	structs.insert({"int"  , type});
 	type.name = "float";
 	structs.insert({"float", type});
+	type.name = "double";
+	structs.insert({"double", type});
 	type.name = "bool";
 	structs.insert({"bool" , type});
+
+	//Sized integers
+	for(auto name : {"i16", "i64", "u8", "u32", "u64"}) {
+		type.name = name;
+		structs.insert({name, type});
+	}
 }
 
 void SymTable::dump() const {
@@ -35,7 +72,17 @@ void SymTable::dump() const {
 }
 
 bool SymTable::pushFunc(const std::string &identifier, FunctionSignature *func) {
-	return functions.insert({identifier, func}).second;
+	return !isBuiltin(identifier) && functions.insert({identifier, func}).second;
+}
+
+//Vector operations that are called like functions
+bool SymTable::isBuiltin(const std::string &identifier) {
+	static const std::unordered_set<std::string> builtins = {
+		"shuffle", "reduceAdd", "reduceMul", "reduceMin", "reduceMax", "any", "all",
+		"loadLanes", "storeLanes", "loadMasked", "storeMasked",
+		"reserve", "append", "resize", "shrink", "clone", "copy", "transpose", "sizeof", "alignof", "offsetof"
+	};
+	return builtins.count(identifier) > 0;
 }
 
 void SymTable::setActiveFunction(const std::string &str) {
@@ -171,8 +218,16 @@ void SymTable::visit(StructAstNode &node) {
 
 void SymTable::visit(FunctionAstNode &node) {
 	foundEarlyReturn = false;
+	addressTaken.clear();
+	finishedBoundsLoops.clear();
 	currentFunction = &node.signature;
 	locals = &allLocals.find(node.signature.name)->second;
+	for(auto hint : node.hints) {
+		if(hint->value != "fastmath") {
+			Global::errStack.push("Unknown function hint '" + hint->value + "'", hint);
+		}
+	}
+
 	for(size_t i = 0; i < node.signature.parameters.size(); i++) {
 		locals->insert(std::make_pair(
 			node.signature.paramNames[i],
@@ -202,11 +257,27 @@ void SymTable::visit(FunctionAstNode &node) {
 				+ node.signature.returnType.string() + "'", node.token);
 	}
 
+	resolveBoundsLoops();
 	//locals->clear();
 }
 
 void SymTable::visit(ExternAstNode &node) {
-	//TODO: ?
+	//Attributes that may be promised about an external function
+	static const std::unordered_set<std::string> known = {
+		"nounwind", "readnone", "readonly", "writeonly", "argmemonly",
+		"inaccessiblememonly", "inaccessiblemem_or_argmemonly",
+		"nofree", "willreturn", "noreturn", "noalias"
+	};
+
+	for(auto attribute : node.attributes) {
+		if(known.count(attribute->value) == 0) {
+			Global::errStack.push("Unknown attribute '" + attribute->value
+				+ "' on extern function '" + node.name + "'", attribute);
+		} else if(attribute->value == "noalias" && node.signature.returnType.isPtr == 0) {
+			Global::errStack.push("Attribute 'noalias' requires extern function '"
+				+ node.name + "' to return a pointer", attribute);
+		}
+	}
 }
 
 void SymTable::visit(VariableDeclareAstNode &node) {
@@ -228,6 +299,16 @@ void SymTable::visit(VariableDeclareAstNode &node) {
 		return;
 	}
 
+	auto tile = node.type.tileSize;
+	if(node.type.arrayOf && (tile & (tile - 1) || tile == 1 || tile > 64) ) {
+		Global::errStack.push("Tile size of '" + node.type.string()
+			+ "' must be a power of two from 2 to 64", node.token);
+		return;
+	} else if(node.type.isSlice && tile > 0) {
+		Global::errStack.push("Cannot slice a tiled array, its blocks are not split", node.token);
+		return;
+	}
+
 	//Check function redefinition
 	if(hasFunc(node.identifier) ) { 
 		Global::errStack.push("Redefinition of identifier '" + node.identifier 
@@ -245,14 +326,46 @@ void SymTable::visit(VariableDeclareAstNode &node) {
 			node.children.front()->children.back()->accept(*this);
 			node.type = callArgTypes.front();
 			callArgTypes.clear();
+		} else if(node.type.isInteger() && node.type.isPtr == 0 && !node.children.empty() ) {
+			//Integer initializers are extended to the declared type by their own signedness
+			auto &init = *node.children.front()->children.back();
+			init.accept(*this);
+			if(!callArgTypes.empty() ) {
+				markUnsigned(init, callArgTypes.back() );
+			}
+			callArgTypes.clear();
 		}
 	} else {
 		Global::errStack.push("Redefinition of variable '"
 				+ node.identifier + '\'', node.token);
 	}
 
+	//Arrays of the other layout are transposed, the initializer is not visited otherwise
+	if(node.type.arrayOf && !node.children.empty() ) {
+		auto source = dynamic_cast<VariableAstNode*>(node.children.front()->children.back().get() );
+		auto local = source && source->children.empty() ? locals->find(source->name) : locals->end();
+		if(local != locals->end() && isTransposed(node.type, *local->second.type) ) {
+			transposeSource(*node.children.front() );
+		}
+	}
+
+	if(node.allocator) {
+		visitAllocator(node);
+	} else if(arenaDepth > 0 && !insideStructDecl) {	//Same kind of arrays that may take an allocator
+		auto init = node.children.empty() ? nullptr : node.children.front()->children.back().get();
+		node.region = node.type.arrayOf && node.type.isPtr == 0 && !node.type.isSlice && node.type.tileSize == 0
+			&& (!init || dynamic_cast<ArrayAstNode*>(init) );
+	}
+
+	//Initializers of typed declarations are not visited, but may still affect bounds checks
+	if(!node.type.name.empty() || node.type.arrayOf) {
+		for(const auto &child : node.children) {
+			scanUnchecked(child.get() );
+		}
+	}
+
 	if(insideStructDecl) {
-		visitedMembers.push_back({node.identifier, node.type});
+		visitedMembers.push_back({node.identifier, node.type, node.heat});
 	}
 }
 
@@ -262,8 +375,12 @@ void SymTable::visit(ReturnAstNode &node) {
 		child->accept(*this);
 	}
 
+	if(!node.children.empty() && !callArgTypes.empty() ) {
+		markUnsigned(*node.children.front(), callArgTypes.back() );
+	}
+
 	for(auto &t : callArgTypes) {
-		if(t != currentFunction->returnType) {
+		if(t != currentFunction->returnType && !(t.isInteger() && currentFunction->returnType.isInteger() ) ) {
 			Global::errStack.push("Function '" + currentFunction->name 
 					+ "' tries to return value of type '" + t.string() 
 					+ "', when definition specifies it to return '"
@@ -291,6 +408,17 @@ void SymTable::visit(BranchAstNode &node) {
 	blockDepth--;
 }
 
+void SymTable::visit(ArenaAstNode &node) {
+	blockDepth++;
+	arenaDepth++;
+	for(const auto &child : node.children) {
+		child->accept(*this);
+		callArgTypes.clear();
+	}
+	arenaDepth--;
+	blockDepth--;
+}
+
 void SymTable::visit(LoopAstNode &node) {
 	blockDepth++;
 	if(node.loopPrefix) {
@@ -298,6 +426,9 @@ void SymTable::visit(LoopAstNode &node) {
 		callArgTypes.clear();
 	}
 
+	BoundsLoop boundsLoop;
+	bool isBoundsLoop = matchBoundsLoop(node, boundsLoop);
+
 	node.expr->accept(*this);
 	callArgTypes.clear();
 	if(!demoteExprToBool(node.expr) ) {
@@ -311,17 +442,33 @@ void SymTable::visit(LoopAstNode &node) {
 		callArgTypes.clear();
 	}
 
+	if(isBoundsLoop) {
+		boundsLoops.push_back(std::move(boundsLoop) );
+	}
 
+	for(const auto &hint : node.hints) {
+		checkLoopHint(hint);
+	}
 
 	//TODO: LOCALS?????
 	for(const auto &child : node.children) {
 		child->accept(*this);
 	}
 
+	if(isBoundsLoop) {
+		finishedBoundsLoops.push_back(std::move(boundsLoops.back() ) );
+		boundsLoops.pop_back();
+	}
+
 	blockDepth--;
 }
 
 void SymTable::visit(CallAstNode &node) {
+	if(isBuiltin(node.identifier) ) {
+		visitBuiltin(node);
+		return;
+	}
+
 	auto sig = hasFunc(node.identifier);
 	if(!sig) {
 		Global::errStack.push("Function '" + node.identifier 
@@ -334,6 +481,17 @@ void SymTable::visit(CallAstNode &node) {
 		node->accept(*this);
 	}
 
+	for(const auto &type : callArgTypes) {
+		if(mayReachArray(type) ) {
+			noteOpaqueCall();
+			break;
+		}
+	}
+
+	for(size_t i = 0; i < node.children.size() && i < callArgTypes.size(); i++) {
+		markUnsigned(*node.children[i], callArgTypes[i]);
+	}
+
 	auto matches = [](const std::vector<Type> &sig, const std::vector<Type> &args) {
 		size_t overlap = 0;
 		Type voidPtrTy;
@@ -345,7 +503,18 @@ void SymTable::visit(CallAstNode &node) {
 				continue;
 			}
 
-			if(*sigit != *argsit) {
+			if(sigit->isInteger() && argsit->isInteger() ) {	//Converted implicitly
+				continue;
+			}
+
+			//Slices and arrays of the same elements convert into one another
+			if(sigit->arrayOf && argsit->arrayOf && sigit->isPtr == 0 && argsit->isPtr == 0
+					&& sigit->realignedArray == argsit->realignedArray && sigit->tileSize == argsit->tileSize
+					&& *sigit->arrayOf == *argsit->arrayOf) {
+				continue;
+			}
+
+			if(*sigit != *argsit || sigit->tileSize != argsit->tileSize) {
 				break;
 			}
 		}
@@ -396,15 +565,54 @@ void SymTable::visit(BinExpressionAstNode &node) {
 		child->accept(*this);
 	}
 
+	if(node.type == TokenType::Assign) {
+		auto target = dynamic_cast<VariableAstNode*>(node.children.front().get() );
+		if(target && target->children.empty() ) {
+			noteAssign(target->name);
+		} else if(callArgTypes.size() == 2 && callArgTypes.front().arrayOf) {
+			noteShrink("");
+		}
+	}
+
 	if(callArgTypes.size() != 2) {
 		return;
 	}
 
 	auto &lhs = callArgTypes.front();
 	auto &rhs = callArgTypes.back();
+	markUnsigned(*node.children.front(), lhs);
+	markUnsigned(*node.children.back(), rhs);
+
+	if(node.type == TokenType::Assign && isTransposed(lhs, rhs) ) {
+		transposeSource(node);
+		rhs = lhs;
+	}
+
+	//Integers of different widths convert implicitly, operands are widened to the wider type
+	if(lhs.isInteger() && rhs.isInteger() && lhs != rhs) {
+		if(node.type == TokenType::Assign) {
+			rhs = lhs;
+		} else if(node.type != TokenType::Push) {
+			lhs = rhs = promote(lhs, rhs);
+		}
+	}
+
+	//Scalars combined with vectors apply to every lane
+	auto isLane = [](const Type &scalar, const Type &vector) {
+		return vector.lanes > 0 && vector.isPtr == 0 && scalar.lanes == 0 && scalar.isPtr == 0
+			&& !scalar.arrayOf && scalar.name == vector.name;
+	};
+	if(node.type != TokenType::Assign && node.type != TokenType::Push) {
+		if(isLane(rhs, lhs) ) {
+			rhs = lhs;
+		} else if(isLane(lhs, rhs) ) {
+			lhs = rhs;
+		}
+	}
 
 	if(node.type == TokenType::Push) {	//Push edge case
-		if(lhs.isPtr == 0 && *lhs.arrayOf == rhs) {
+		if(lhs.isPtr == 0 && lhs.arrayOf && !lhs.isSlice && lhs.tileSize == 0 && (*lhs.arrayOf == rhs
+				|| (lhs.arrayOf->isInteger() && rhs.isInteger() ) ) ) {
 			types.push_back(rhs);
 			callArgTypes = std::move(types);
 			return;
@@ -423,6 +631,7 @@ void SymTable::visit(BinExpressionAstNode &node) {
 	} else {
 		Type boolType;
 		boolType.name = "bool";
+		boolType.lanes = rhs.isPtr == 0 ? rhs.lanes : 0;	//Vectors compare lane by lane
 		switch(node.type) {
 			case TokenType::Add:
 			case TokenType::Multiply:
@@ -453,6 +662,15 @@ void SymTable::visit(UnaryExpressionAstNode &node) {
 		child->accept(*this);
 	}
 
+	auto target = node.children.empty() ? nullptr 
+		: dynamic_cast<VariableAstNode*>(node.children.front().get() );
+	bool isPlain = target && target->children.empty();
+	if(node.type == TokenType::Multiply && isPlain) {
+		addressTaken.insert(target->name);
+	} else if(node.type == TokenType::Pop || node.type == TokenType::Tilde) {
+		noteShrink(isPlain ? target->name : "");
+	}
+
 	if(callArgTypes.empty() ) {
 		return;
 	}
@@ -466,16 +684,22 @@ void SymTable::visit(UnaryExpressionAstNode &node) {
 	} else if(node.type == TokenType::Multiply) { 
 		callArgTypes.back().isPtr++;
 	} else if(node.type == TokenType::Ternary) {
-		Type intType;
-		intType.name = "int";
-		callArgTypes.back() = intType;
+		Type lengthType;
+		lengthType.name = "i64";
+		callArgTypes.back() = lengthType;
 	} else if(node.type == TokenType::Pop) {
+		if(callArgTypes.back().isSlice) {
+			Global::errStack.push("Cannot pop from a slice, it borrows its elements", node.token);
+		}
+
 		Type voidType;
 		voidType.name = "void";
 		callArgTypes.back() = voidType;
 	} else if(node.type == TokenType::Tilde) {
 		if(!callArgTypes.back().arrayOf) {
 			Global::errStack.push("Cannot free non-array construct", node.token);
+		} else if(callArgTypes.back().isSlice) {
+			Global::errStack.push("Cannot free a slice, it borrows its elements", node.token);
 		}
 
 		Type voidType;
@@ -496,6 +720,16 @@ void SymTable::visit(CastExpressionAstNode &node) {
 		return;
 	}
 
+	//Scalars are splat into vectors, vectors convert lane by lane
+	auto &from = callArgTypes.back();
+	markUnsigned(*node.children.front(), from);
+	if(from.isPtr == 0 && from.lanes > 0 && node.type.lanes != from.lanes) {
+		Global::errStack.push("Cannot cast '" + from.string()
+				+ "' into '" + node.type.string() + "'", node.token);
+		callArgTypes.clear();
+		return;
+	}
+
 	//I mean...
 	callArgTypes.back() = node.type;
 }
@@ -503,12 +737,11 @@ void SymTable::visit(CastExpressionAstNode &node) {
 void SymTable::visit(ArrayAstNode &node) {
 	if(node.length) {
 		node.length->accept(*this);
-		Type intType;
-		intType.name = "int";
-		if(callArgTypes.back() != intType) {
-			Global::errStack.push("Array declaration expects length definition to be of type 'int'", 
+		if(!callArgTypes.back().isInteger() ) {
+			Global::errStack.push("Array declaration expects length definition to be an integer", 
 				node.length->token);
 		}
+		markUnsigned(*node.length, callArgTypes.back() );
 		callArgTypes.back() = node.type;
 	} else {
 		callArgTypes.push_back(node.type);
@@ -516,22 +749,57 @@ void SymTable::visit(ArrayAstNode &node) {
 }
 
 void SymTable::visit(IndexAstNode &node) {
-	if(!callArgTypes.back().arrayOf) {
-		Global::errStack.push("Cannot index into type '" + callArgTypes.back().string() + "'", node.token);
+	auto var = indexedVariable;
+	indexedVariable = nullptr;
+	bool isVector = callArgTypes.back().lanes > 0 && callArgTypes.back().isPtr == 0;
+	if(var && var->children.front().get() == &node && !isVector && !node.isSlice) {
+		addBoundsCandidate(var, node);
+	}
+
+	if(!callArgTypes.back().arrayOf && (!isVector || node.isSlice) ) {
+		Global::errStack.push("Cannot " + std::string(node.isSlice ? "slice" : "index into") + " type '"
+			+ callArgTypes.back().string() + "'", node.token);
 	}
 
 	node.index->accept(*this);
-	Type intType;
-	intType.name = "int";
-	if(callArgTypes.back() != intType) {
-		Global::errStack.push("Indexing a variable requires the index to be of type 'int'",
+	if(!callArgTypes.back().isInteger() ) {
+		Global::errStack.push("Indexing a variable requires the index to be an integer",
 			node.index->token);
 	} /*else {
 		return;
 	}*/
+	markUnsigned(*node.index, callArgTypes.back() );
 
 	callArgTypes.pop_back();
 
+	if(node.isSlice) {	//View of the same elements, also of every column of a realigned array
+		if(callArgTypes.back().tileSize > 0) {
+			Global::errStack.push("Cannot slice a tiled array, its blocks are not split", node.token);
+		}
+		if(node.end) {
+			node.end->accept(*this);
+			if(!callArgTypes.back().isInteger() ) {
+				Global::errStack.push("Slicing a variable requires the bounds to be integers",
+					node.end->token);
+			}
+			markUnsigned(*node.end, callArgTypes.back() );
+			callArgTypes.pop_back();
+		}
+		callArgTypes.back().isPtr = 0;
+		callArgTypes.back().isSlice = true;
+		return;
+	}
+
+	if(isVector) {	//Lane of a vector
+		auto lane = dynamic_cast<IntAstNode*>(node.index.get() );
+		if(lane && (lane->value < 0 || lane->value >= callArgTypes.back().lanes) ) {
+			Global::errStack.push("Lane " + std::to_string(lane->value) + " is out of range for '"
+				+ callArgTypes.back().string() + "'", node.index->token);
+		}
+		callArgTypes.back().lanes = 0;
+		return;
+	}
+
 	if(callArgTypes.back().realignedArray && node.children.empty() ) {
 		Global::errStack.push("Cannot index into a realigned array without also specifying a member",
 			node.index->token);
@@ -571,6 +839,7 @@ void SymTable::visit(VariableAstNode &node) {
 			+ node.name + "' used but never defined", node.token);
 	} else {
 		callArgTypes.push_back(*it->second.type);
+		indexedVariable = node.children.empty() ? nullptr : &node;
 		for(const auto &child : node.children) {
 			child->accept(*this);
 		}
@@ -586,10 +855,16 @@ void SymTable::visit(StringAstNode &node) {
 
 void SymTable::visit(IntAstNode &node) {
 	Type intType;
-	intType.name = "int";
+	intType.name = node.value < INT_MIN || node.value > INT_MAX ? "i64" : "int";
 	callArgTypes.push_back(intType);
 }
 
+void SymTable::visit(FloatAstNode &node) {
+	Type floatType;
+	floatType.name = node.isDouble ? "double" : "float";
+	callArgTypes.push_back(floatType);
+}
+
 void SymTable::visit(BoolAstNode &node) {
 	Type boolType;
 	boolType.name = "bool";
@@ -599,10 +874,9 @@ void SymTable::visit(BoolAstNode &node) {
 bool SymTable::demoteExprToBool(AstNode::Expr &expr) {
 	expr->accept(*this);
 	Type &result = callArgTypes.back();
-	Type intType, boolType;
-	intType.name = "int";
+	Type boolType;
 	boolType.name = "bool";
-	if(result == intType || result.isPtr > 0) { //Compare numeric values to zero		
+	if(result.isInteger() || result.isPtr > 0) { //Compare numeric values to zero		
 		auto binop = std::make_unique<BinExpressionAstNode>(TokenType::NotEquivalence);
 		binop->addChild(std::move(expr) );
 		binop->addChild(std::make_unique<IntAstNode>(0) );
@@ -617,3 +891,420 @@ bool SymTable::demoteExprToBool(AstNode::Expr &expr) {
 	callArgTypes.clear();
 	return true;
 }
+
+void SymTable::visitBuiltin(CallAstNode &node) {
+	if(isLayoutQuery(node.identifier) ) {
+		visitLayoutQuery(node);
+		return;
+	}
+
+	auto oldTypes = std::move(callArgTypes);
+	for(const auto &child : node.children) {
+		child->accept(*this);
+	}
+	auto args = std::move(callArgTypes);
+	callArgTypes = std::move(oldTypes);
+
+	Type result;
+	result.name = "void";
+	if(args.size() != node.children.size() ) {	//Arguments are broken already
+		return;
+	}
+
+	auto isVector = [](const Type &type) {
+		return type.lanes > 0 && type.isPtr == 0;
+	};
+	auto isElementPtr = [](const Type &type) {	//Address of a number, e.g. *values[i]
+		return type.isPtr == 1 && type.lanes == 0 && !type.arrayOf
+			&& (type.name == "int" || type.name == "char" || type.name == "float" || type.name == "double");
+	};
+	auto isMask = [&](const Type &type, unsigned lanes) {
+		return isVector(type) && type.name == "bool" && (lanes == 0 || type.lanes == lanes);
+	};
+	auto literal = [&](size_t i) {
+		return dynamic_cast<IntAstNode*>(node.children[i].get() );
+	};
+	auto isArrayPtr = [](const Type &type) {	//Address of an array, e.g. *values
+		return type.isPtr == 1 && type.arrayOf && !type.realignedArray && !type.isSlice;
+	};
+
+	std::string expected;
+	const auto &name = node.identifier;
+	if(name == "shuffle") {
+		expected = "two vectors of the same type followed by constant lane indices";
+		bool valid = args.size() > 2 && isVector(args[0]) && args[0] == args[1]
+			&& Type::isLaneCount(args.size() - 2);
+		for(size_t i = 2; valid && i < args.size(); i++) {
+			auto lane = literal(i);
+			valid = lane && lane->value >= 0 && lane->value < 2 * static_cast<int>(args[0].lanes);
+		}
+
+		if(valid) {
+			result = args[0];
+			result.lanes = args.size() - 2;
+			expected.clear();
+		}
+	} else if(name == "reduceAdd" || name == "reduceMul" || name == "reduceMin" || name == "reduceMax") {
+		expected = "a vector of numbers";
+		if(args.size() == 1 && isVector(args[0]) && args[0].name != "bool") {
+			result = args[0];
+			result.lanes = 0;
+			expected.clear();
+		}
+	} else if(name == "any" || name == "all") {
+		expected = "a vector of bools";
+		if(args.size() == 1 && isMask(args[0], 0) ) {
+			result.name = "bool";
+			expected.clear();
+		}
+	} else if(name == "loadLanes") {
+		expected = "the address of an element and a constant lane count";
+		if(args.size() == 2 && isElementPtr(args[0]) && literal(1)
+				&& Type::isLaneCount(literal(1)->value) ) {
+			result = args[0];
+			result.isPtr = 0;
+			result.lanes = literal(1)->value;
+			expected.clear();
+		}
+	} else if(name == "loadMasked") {
+		expected = "the address of an element and a mask";
+		if(args.size() == 2 && isElementPtr(args[0]) && isMask(args[1], 0) ) {
+			result = args[0];
+			result.isPtr = 0;
+			result.lanes = args[1].lanes;
+			expected.clear();
+		}
+	} else if(name == "storeLanes" || name == "storeMasked") {
+		expected = name == "storeLanes" ? "the address of an element and a vector of its type"
+			: "the address of an element, a vector of its type and a mask";
+		size_t count = name == "storeLanes" ? 2 : 3;
+		if(args.size() == count && isElementPtr(args[0]) && isVector(args[1])
+				&& args[1].name == args[0].name && (count == 2 || isMask(args[2], args[1].lanes) ) ) {
+			expected.clear();
+		}
+	} else if(name == "reserve" || name == "resize") {
+		expected = "the address of an array and an element count";
+		bool realigned = name == "reserve" && args.size() == 2 && args[0].isPtr == 1 && args[0].realignedArray
+			&& !args[0].isSlice && args[0].tileSize == 0;	//Realigned arrays grow, but are not resized
+		if(args.size() == 2 && (isArrayPtr(args[0]) || realigned) && args[1].isInteger() ) {
+			markUnsigned(*node.children[1], args[1]);
+			expected.clear();
+		}
+	} else if(name == "append") {
+		expected = "the address of an array and an array of the same type";
+		if(args.size() == 2 && isArrayPtr(args[0]) && args[1].isPtr == 0 && args[1].arrayOf
+				&& *args[1].arrayOf == *args[0].arrayOf && !args[1].realignedArray) {
+			expected.clear();
+		}
+	} else if(name == "shrink") {
+		expected = "the address of an array";
+		if(args.size() == 1 && isArrayPtr(args[0]) ) {
+			expected.clear();
+		}
+	} else if(name == "clone") {
+		expected = "an array or a slice";
+		if(args.size() == 1 && args[0].arrayOf && args[0].isPtr == 0 && args[0].tileSize == 0) {
+			result = args[0];
+			result.isSlice = false;
+			expected.clear();
+		}
+	} else if(name == "transpose") {	//A copy in the other layout, []T to []@T and back
+		expected = "an array or a slice of structs";
+		if(args.size() == 1 && args[0].arrayOf && args[0].isPtr == 0 && args[0].tileSize == 0
+				&& args[0].arrayOf->isStruct() ) {
+			result = args[0];
+			result.isSlice = false;
+			result.realignedArray = !result.realignedArray;
+			expected.clear();
+		}
+	} else if(name == "copy") {	//Realigned arrays are copied column by column
+		expected = "the address of an array and an array or a slice of the same type";
+		if(args.size() == 2 && args[0].isPtr == 1 && args[0].arrayOf && !args[0].isSlice
+				&& args[1].isPtr == 0 && args[1].arrayOf && *args[1].arrayOf == *args[0].arrayOf
+				&& args[1].realignedArray == args[0].realignedArray
+				&& args[0].tileSize == 0 && args[1].tileSize == 0) {
+			expected.clear();
+		}
+	}
+
+	if(!expected.empty() ) {
+		Global::errStack.push("Builtin '" + name + "' expects " + expected, node.token);
+		return;
+	}
+
+	//A resized array may end up shorter than a loop bound read before
+	if(name == "resize" || name == "copy") {
+		auto address = dynamic_cast<UnaryExpressionAstNode*>(node.children.front().get() );
+		auto target = address ? dynamic_cast<VariableAstNode*>(address->children.front().get() ) : nullptr;
+		noteShrink(target && target->children.empty() ? target->name : "");
+	}
+	callArgTypes.push_back(result);
+}
+
+bool SymTable::isTransposed(const Type &lhs, const Type &rhs) {
+	//Equal types apart from the layout, which == does not compare
+	return lhs.arrayOf && rhs.arrayOf && lhs.isPtr == 0 && rhs.isPtr == 0 && !lhs.isSlice
+		&& lhs.realignedArray != rhs.realignedArray && lhs.tileSize == 0 && rhs.tileSize == 0
+		&& *lhs.arrayOf == *rhs.arrayOf;
+}
+
+void SymTable::transposeSource(AstNode &assign) {
+	auto call = std::make_unique<CallAstNode>("transpose");
+	call->token = assign.children.back()->token;
+	call->addChild(std::move(assign.children.back() ) );
+	assign.children.back() = std::move(call);
+}
+
+void SymTable::visitAllocator(VariableDeclareAstNode &node) {
+	//Only whole arrays that start out with storage from the allocator, or none at all
+	const auto &type = node.type;
+	auto init = node.children.empty() ? nullptr : node.children.front()->children.back().get();
+	if(insideStructDecl) {
+		Global::errStack.push("Struct member '" + node.identifier + "' may not take an allocator", node.token);
+		return;
+	} else if(!type.arrayOf || type.isPtr > 0 || type.isSlice || type.tileSize > 0) {
+		Global::errStack.push("Only array variables may take an allocator, not '" + type.string() + "'",
+			node.token);
+		return;
+	} else if(init && !dynamic_cast<ArrayAstNode*>(init) ) {
+		Global::errStack.push("Array '" + node.identifier
+			+ "' with an allocator must be initialized with a new array", node.token);
+		return;
+	}
+
+	callArgTypes.clear();
+	node.allocator->accept(*this);
+	if(callArgTypes.empty() ) {
+		return;
+	}
+
+	auto allocator = callArgTypes.front();
+	callArgTypes.clear();
+	if(allocator.name != "Allocator" || allocator.isPtr != 1 || allocator.arrayOf) {
+		Global::errStack.push("Allocator of '" + node.identifier + "' must be an 'Allocator*', not '"
+			+ allocator.string() + "', see lib/alloc.gh", node.allocator->token);
+	}
+}
+
+bool SymTable::isLayoutQuery(const std::string &identifier) {
+	return identifier == "sizeof" || identifier == "alignof" || identifier == "offsetof";
+}
+
+void SymTable::visitLayoutQuery(CallAstNode &node) {
+	//Arguments name a type, a member or a variable and are never evaluated
+	auto named = [&](size_t i) -> VariableAstNode* {
+		auto var = i < node.children.size() ? dynamic_cast<VariableAstNode*>(node.children[i].get() ) : nullptr;
+		return var && var->children.empty() ? var : nullptr;
+	};
+	auto isType = [&](VariableAstNode *var) {
+		return var && (Type::isPrimitive(var->name) || hasStruct(var->name) );
+	};
+
+	std::string expected;
+	auto type = named(0);
+	const auto &name = node.identifier;
+	if(name == "offsetof") {
+		expected = "a struct and one of its members";
+		auto member = named(1);
+		auto struc = type ? hasStruct(type->name) : nullptr;
+		if(node.children.size() == 2 && struc && member && std::any_of(struc->members.begin(), struc->members.end(),
+				[&](const Member &m) { return m.identifier == member->name; }) ) {
+			expected.clear();
+		}
+	} else if(name == "alignof") {
+		expected = "a type";
+		if(node.children.size() == 1 && isType(type) ) {
+			expected.clear();
+		}
+	} else {
+		expected = "a type or a variable";
+		if(node.children.size() == 1 && isType(type) ) {
+			expected.clear();
+		} else if(node.children.size() == 1 && type) {
+			auto it = locals->find(type->name);
+			if(it != locals->end() && it->second.depth <= blockDepth) {
+				expected.clear();
+			}
+		}
+	}
+
+	if(!expected.empty() ) {
+		Global::errStack.push("Builtin '" + name + "' expects " + expected, node.token);
+		return;
+	}
+
+	Type result;
+	result.name = "u64";
+	callArgTypes.push_back(result);
+}
+
+void SymTable::checkLoopHint(const LoopHint &hint) {
+	//Hints that take a count, and whether it is required
+	static const Map<bool> known = {
+		{"vectorize", false}, {"unroll", false}, {"interleave", true}, {"distribute", false}
+	};
+
+	auto it = known.find(hint.token->value);
+	if(it == known.end() ) {
+		Global::errStack.push("Unknown loop hint '" + hint.token->value + "'", hint.token);
+	} else if(it->second && hint.count == 0) {
+		Global::errStack.push("Loop hint '" + hint.token->value + "' requires a count", hint.token);
+	} else if(hint.token->value == "distribute" && hint.count != 0) {
+		Global::errStack.push("Loop hint 'distribute' does not take a count", hint.token);
+	} else if(hint.count < 0 || hint.count > 64) {
+		Global::errStack.push("Count of loop hint '" + hint.token->value
+			+ "' must be between 1 and 64", hint.token);
+	}
+}
+
+bool SymTable::matchBoundsLoop(LoopAstNode &node, BoundsLoop &loop) {
+	//for i64 i = <non-negative literal>, narrower inductions could wrap before reaching a?
+	auto prefix = dynamic_cast<VariableDeclareAstNode*>(node.loopPrefix.get() );
+	if(!prefix || !prefix->type.isInteger() || prefix->type.size() != 8 || prefix->children.empty() ) {
+		return false;
+	}
+
+	auto init = dynamic_cast<IntAstNode*>(prefix->children.front()->children.back().get() );
+	if(!init || init->value < 0) {
+		return false;
+	}
+	loop.induction = prefix->identifier;
+
+	//i < a?
+	auto cond = dynamic_cast<BinExpressionAstNode*>(node.expr.get() );
+	if(!cond || cond->type != TokenType::Less) {
+		return false;
+	}
+
+	auto lhs = dynamic_cast<VariableAstNode*>(cond->children.front().get() );
+	auto length = dynamic_cast<UnaryExpressionAstNode*>(cond->children.back().get() );
+	if(!lhs || !lhs->children.empty() || lhs->name != loop.induction 
+			|| !length || length->type != TokenType::Ternary) {
+		return false;
+	}
+
+	auto array = dynamic_cast<VariableAstNode*>(length->children.front().get() );
+	if(!array || !array->children.empty() ) {
+		return false;
+	}
+
+	auto it = locals->find(array->name);
+	if(it == locals->end() || !it->second.type->arrayOf) {
+		return false;
+	}
+	loop.array = array->name;
+	loop.arrayIsPtr = it->second.type->isPtr > 0;
+
+	//i = i + 1
+	auto step = dynamic_cast<BinExpressionAstNode*>(node.loopSuffix.get() );
+	if(!step || step->type != TokenType::Assign) {
+		return false;
+	}
+
+	auto target = dynamic_cast<VariableAstNode*>(step->children.front().get() );
+	auto inc = dynamic_cast<BinExpressionAstNode*>(step->children.back().get() );
+	if(!target || !target->children.empty() || target->name != loop.induction
+			|| !inc || inc->type != TokenType::Add) {
+		return false;
+	}
+
+	auto incVar = dynamic_cast<VariableAstNode*>(inc->children.front().get() );
+	auto incVal = dynamic_cast<IntAstNode*>(inc->children.back().get() );
+	return incVar && incVar->children.empty() && incVar->name == loop.induction
+		&& incVal && incVal->value == 1;
+}
+
+void SymTable::resolveBoundsLoops() {
+	for(auto &loop : finishedBoundsLoops) {
+		//An array whose header may be reached from elsewhere can be shrunk behind our back
+		bool isExposed = loop.arrayIsPtr || addressTaken.count(loop.array) > 0;
+		if(loop.invalid || addressTaken.count(loop.induction) > 0
+				|| (isExposed && (loop.foreignShrink || loop.opaqueCall) ) ) {
+			continue;
+		}
+
+		for(auto index : loop.candidates) {
+			index->provenInBounds = true;
+		}
+	}
+	finishedBoundsLoops.clear();
+}
+
+void SymTable::scanUnchecked(AstNode *node) {
+	if(!node) {
+		return;
+	}
+
+	if(auto var = dynamic_cast<VariableAstNode*>(node) ) {
+		if(!var->children.empty() ) {
+			if(auto index = dynamic_cast<IndexAstNode*>(var->children.front().get() ) ) {
+				addBoundsCandidate(var, *index);
+			}
+		}
+	} else if(auto un = dynamic_cast<UnaryExpressionAstNode*>(node) ) {
+		auto target = un->children.empty() ? nullptr 
+			: dynamic_cast<VariableAstNode*>(un->children.front().get() );
+		bool isPlain = target && target->children.empty();
+		if(un->type == TokenType::Multiply && isPlain) {
+			addressTaken.insert(target->name);
+		} else if(un->type == TokenType::Pop || un->type == TokenType::Tilde) {
+			noteShrink(isPlain ? target->name : "");
+		}
+	} else if(auto bin = dynamic_cast<BinExpressionAstNode*>(node) ) {
+		if(bin->type == TokenType::Assign) {
+			auto target = dynamic_cast<VariableAstNode*>(bin->children.front().get() );
+			if(target && target->children.empty() ) {
+				noteAssign(target->name);
+			} else {
+				noteShrink("");
+			}
+		}
+	} else if(dynamic_cast<CallAstNode*>(node) ) {
+		noteOpaqueCall();
+	} else if(auto index = dynamic_cast<IndexAstNode*>(node) ) {
+		scanUnchecked(index->index.get() );
+	} else if(auto array = dynamic_cast<ArrayAstNode*>(node) ) {
+		scanUnchecked(array->length.get() );
+	}
+
+	for(const auto &child : node->children) {
+		scanUnchecked(child.get() );
+	}
+}
+
+void SymTable::addBoundsCandidate(VariableAstNode *var, IndexAstNode &node) {
+	auto index = dynamic_cast<VariableAstNode*>(node.index.get() );
+	if(!index || !index->children.empty() ) {
+		return;
+	}
+
+	for(auto &loop : boundsLoops) {
+		if(loop.array == var->name && loop.induction == index->name) {
+			loop.candidates.push_back(&node);
+		}
+	}
+}
+
+void SymTable::noteAssign(const std::string &identifier) {
+	for(auto &loop : boundsLoops) {
+		if(loop.induction == identifier || loop.array == identifier) {
+			loop.invalid = true;
+		}
+	}
+}
+
+void SymTable::noteShrink(const std::string &identifier) {
+	for(auto &loop : boundsLoops) {
+		if(loop.array == identifier) {
+			loop.invalid = true;
+		} else {
+			loop.foreignShrink = true;
+		}
+	}
+}
+
+void SymTable::noteOpaqueCall() {
+	for(auto &loop : boundsLoops) {
+		loop.opaqueCall = true;
+	}
+}
@@ -9,6 +9,9 @@ Type::Type(const Type &rhs) {
 	isPtr = rhs.isPtr;
 	members = rhs.members;
 	realignedArray = rhs.realignedArray;
+	tileSize = rhs.tileSize;
+	isSlice = rhs.isSlice;
+	lanes = rhs.lanes;
 	if(rhs.arrayOf) {
 		arrayOf = std::make_unique<Type>(*rhs.arrayOf);
 	}
@@ -24,7 +27,7 @@ bool Type::operator==(const Type &rhs) const {
 		return false;
 	}
 
-	return name == rhs.name && isPtr == rhs.isPtr;
+	return name == rhs.name && isPtr == rhs.isPtr && lanes == rhs.lanes && isSlice == rhs.isSlice;
 }
 
 bool Type::operator!=(const Type &rhs) const {
@@ -37,14 +40,23 @@ void Type::swap(Type &rhs) {
 	std::swap(members, rhs.members);
 	std::swap(arrayOf, rhs.arrayOf);
 	std::swap(realignedArray, rhs.realignedArray);
+	std::swap(tileSize, rhs.tileSize);
+	std::swap(isSlice, rhs.isSlice);
+	std::swap(lanes, rhs.lanes);
 }
 
 std::string Type::string() const {
 	std::string buffer = name;
+	if(lanes > 0) {
+		buffer += std::to_string(lanes);
+	}
 	if(arrayOf) {
-		buffer += "[]";
+		buffer += isSlice ? "[:]" : "[]";
 		if(realignedArray) {
 			buffer += "@";
+			if(tileSize > 0) {
+				buffer += std::to_string(tileSize);
+			}
 		}
 	}
 
@@ -78,28 +90,42 @@ std::string Type::fullString() const {
 	return buffer;
 }
 
-int Type::size() const {
+size_t Type::size() const {
 	if(isPtr > 0) {
 		return 8;
 	}
 
 	if(arrayOf) {
-		return 8 + 4 + 4;
+		return isSlice && !realignedArray ? 8 + 8 : 8 + 8 + 8;
 	}
 
-	if(!members.empty() ) {
-		int sum = 0;
+	if(!members.empty() ) {	//Each member starts at a multiple of its alignment, as in the DataLayout
+		size_t sum = 0;
 		for(auto &member : members) {
-			sum += member.type.size();
+			size_t align = member.type.alignment();
+			sum = (sum + align - 1) / align * align + member.type.size();
 		}
-		return sum;
+		size_t align = alignment();
+		return (sum + align - 1) / align * align;
+	}
+
+	if(lanes > 0) {
+		Type element = *this;
+		element.lanes = 0;
+		return element.size() * lanes;
 	}
 
-	if(name == "int") {
+	if(name == "int" || name == "u32") {
 		return 4;
+	} else if(name == "i64" || name == "u64") {
+		return 8;
+	} else if(name == "i16") {
+		return 2;
 	} else if(name == "float") {
 		return 4;
-	} else if(name == "char") {
+	} else if(name == "double") {
+		return 8;
+	} else if(name == "char" || name == "u8" || name == "bool") {
 		return 1;
 	} else if(name == "void") {
 		return 0;
@@ -108,15 +134,42 @@ int Type::size() const {
 	return 0;
 }
 
-bool Type::isStruct() const {
-	if(isPtr > 0
-			|| name == "int" 
-			|| name == "float" 
-			|| name == "bool"
-			|| name == "char" 
-			|| name == "void") {
-		return false;
+size_t Type::alignment() const {
+	if(isPtr > 0 || arrayOf) {
+		return 8;
 	}
 
-	return true;
+	if(!members.empty() ) {
+		size_t align = 1;
+		for(auto &member : members) {
+			align = std::max(align, member.type.alignment() );
+		}
+		return align;
+	}
+
+	return std::max<size_t>(size(), 1);	//Primitives and vectors are aligned to their whole size
+}
+
+bool Type::isLaneCount(long long lanes) {
+	return lanes >= 2 && lanes <= 64 && (lanes & (lanes - 1) ) == 0;
+}
+
+bool Type::isStruct() const {
+	return isPtr == 0 && !isPrimitive(name);
+}
+
+bool Type::isInteger() const {
+	return isPtr == 0 && !arrayOf && lanes == 0 && (name == "int" || name == "char" || name == "i64" 
+		|| name == "i16" || isUnsigned() );
+}
+
+bool Type::isUnsigned() const {
+	return isPtr == 0 && !arrayOf && lanes == 0 && (name == "u64" || name == "u32" || name == "u8");
+}
+
+bool Type::isPrimitive(const std::string &name) {
+	static const std::string primitives[] = {
+		"void", "bool", "char", "i16", "int", "i64", "u8", "u32", "u64", "float", "double"
+	};
+	return std::find(std::begin(primitives), std::end(primitives), name) != std::end(primitives);
 }
@@ -36,6 +36,21 @@ NumValidity isIntLiteral(const std::string &str, int &val) {
 	return NumValidity::Ok;
 }
 
+NumValidity isIntLiteral(const std::string &str, long long &val) {
+	try {
+		std::size_t nRead;
+		val = std::stoll(str, &nRead);
+		if(nRead != str.size() ) {
+			return NumValidity::Invalid;
+		}
+	} catch(std::invalid_argument except ) {
+		return NumValidity::Invalid;
+	} catch(std::out_of_range except) {
+		return NumValidity::Range;
+	}
+	return NumValidity::Ok;
+}
+
 std::string consumeFile(const char* path) {
 	std::ifstream file;
 	file.open(path, std::ios::in | std::ios::binary | std::ios::ate);
@@ -0,0 +1,19 @@
+#!/usr/bin/sh
+# Locals must be allocated in the entry block, never inside a loop body
+
+bin="../build/ghoul"
+status=0
+
+for module in loop locals ; do
+	count=$($bin build "$module" --verbose-ir 2>&1 | awk '
+		/^define / { block = "entrypoint" }
+		/^[0-9A-Za-z_.]+:/ { block = $1; sub(":", "", block) }
+		/ = alloca / && block != "entrypoint" { n++ }
+		END { print n + 0 }')
+	if [ "$count" -ne 0 ] ; then
+		printf "\033[1;31mERROR:\033[0m $count allocas outside the entry block in $module\n"
+		status=1
+	fi
+done
+
+exit $status
@@ -0,0 +1,41 @@
+#!/usr/bin/sh
+# Function attributes inferred from effects, a wrong one silently miscompiles the callers
+
+bin="../build/ghoul"
+ir=$($bin build effects --verbose-ir 2>&1)
+status=0
+
+# Attribute group of the function, with noalias when it returns a noalias pointer
+attributes() {
+	echo "$ir" | awk -v name="@$1(" '
+		/^define / && index($0, name) { group = $NF == "{" ? $(NF - 1) : $NF; if($2 == "noalias") print "noalias" }
+		/^attributes / { groups[$2] = $0 }
+		END { print groups[group] }'
+}
+
+# Every attribute must be present, the ones starting with ! must not be
+expect() {
+	func=$1
+	shift
+	found=$(attributes "$func")
+	for attribute in "$@" ; do
+		case $attribute in
+			!*)
+				echo "$found" | grep -qw -- "${attribute#!}" || continue
+				problem="should not be ${attribute#!}" ;;
+			*)
+				echo "$found" | grep -qw -- "$attribute" && continue
+				problem="should be $attribute" ;;
+		esac
+		printf "\033[1;31mERROR:\033[0m $func $problem, $found\n"
+		status=1
+	done
+}
+
+expect square readnone nounwind nofree willreturn
+expect length readonly argmemonly nounwind nofree willreturn
+expect move argmemonly nounwind willreturn !readonly !readnone
+expect buffer noalias nounwind !readonly !readnone !nofree
+expect main nounwind !readonly !readnone !willreturn
+
+exit $status
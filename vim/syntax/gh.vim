@@ -8,9 +8,10 @@ syn keyword Keyword fn if while for then var
 
 syn keyword Statement return
 
-syn keyword Keyword struct true false volatile
+syn keyword Keyword struct true false volatile inline
 
-syn keyword Type void char int float bool
+syn keyword Type void char i16 int i64 u8 u32 u64 float double bool
+syn match Type '\<\(char\|int\|float\|double\|bool\)\d\+\>'
 
 syn keyword cOperator link extern import
 